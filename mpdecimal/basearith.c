@@ -29,7 +29,9 @@
 #include <stdio.h>
 
 #include "basearith.h"
+#include "bits.h"
 #include "constants.h"
+#include "mpalloc.h"
 #include "mpdecimal.h"
 #include "typearith.h"
 
@@ -268,12 +270,18 @@ _mpd_basemul(mpd_uint_t *w, const mpd_uint_t *u, const mpd_uint_t *v,
 mpd_uint_t
 _mpd_shortdiv(mpd_uint_t *w, const mpd_uint_t *u, mpd_size_t n, mpd_uint_t v)
 {
+    struct word_inverse inv;
     mpd_uint_t hi, lo;
     mpd_uint_t rem = 0;
     mpd_size_t i;
 
     assert(n > 0);
 
+    if (n > MPD_SHORTDIV_INV_MIN) {
+        _mpd_init_word_inverse(&inv, v);
+        return _mpd_shortdiv_inv(w, u, n, &inv);
+    }
+
     for (i=n-1; i != MPD_SIZE_MAX; i--) {
 
         _mpd_mul_words(&hi, &lo, rem, MPD_RADIX);
@@ -287,72 +295,199 @@ _mpd_shortdiv(mpd_uint_t *w, const mpd_uint_t *u, mpd_size_t n, mpd_uint_t v)
 }
 
 /*
- * Knuth, TAOCP Volume 2, 4.3.1:
- *     q, r := quotient and remainder of uconst (len nplusm)
- *             divided by vconst (len n)
- *     nplusm >= n
- *
- * If r is not NULL, r will contain the remainder. If r is NULL, the
- * return value indicates if there is a remainder: 1 for true, 0 for
- * false.  A return value of -1 indicates an error.
+ * Division by an invariant word: N. Moller and T. Granlund, "Improved
+ * Division by Invariant Integers", IEEE Transactions on Computers, 60(2),
+ * 2011. The divisor is shifted left until its most significant bit is set.
+ * With the reciprocal v := floor((2**(2*N) - 1) / dnorm) - 2**N, where N is
+ * the number of bits of a word, a two-word number is divided by dnorm with
+ * two multiplications instead of a hardware division.
  */
-int
-_mpd_basedivmod(mpd_uint_t *q, mpd_uint_t *r,
-                const mpd_uint_t *uconst, const mpd_uint_t *vconst,
-                mpd_size_t nplusm, mpd_size_t n)
+void
+_mpd_init_word_inverse(struct word_inverse *inv, mpd_uint_t d)
 {
-    mpd_uint_t ustatic[MPD_MINALLOC_MAX];
-    mpd_uint_t vstatic[MPD_MINALLOC_MAX];
-    mpd_uint_t *u = ustatic;
-    mpd_uint_t *v = vstatic;
-    mpd_uint_t d, qhat, rhat, w2[2];
-    mpd_uint_t hi, lo, x;
-    mpd_uint_t carry;
-    mpd_size_t i, j, m;
-    int retval = 0;
+    mpd_uint_t r;
 
-    assert(n > 1 && nplusm >= n);
-    m = sub_size_t(nplusm, n);
+    assert(d != 0);
 
-    /* D1: normalize */
-    d = MPD_RADIX / (vconst[n-1] + 1);
+    inv->shift = MPD_BITS_PER_UINT - 1 - mpd_bsr(d);
+    inv->d = d;
+    inv->dnorm = d << inv->shift;
+    _mpd_div_words(&inv->v, &r, ~inv->dnorm, MPD_UINT_MAX, inv->dnorm);
+}
 
-    if (nplusm >= MPD_MINALLOC_MAX) {
-        if ((u = mpd_alloc(nplusm+1, sizeof *u)) == NULL) {
-            return -1;
+/*
+ * Same as _mpd_shortdiv(), with the precomputed inverse of the divisor.
+ * The remainder is kept shifted left by inv->shift, so that the dividend
+ * of each step is (rem * MPD_RADIX + u[i]) * 2**shift.
+ */
+mpd_uint_t
+_mpd_shortdiv_inv(mpd_uint_t *w, const mpd_uint_t *u, mpd_size_t n,
+                  const struct word_inverse *inv)
+{
+    mpd_uint_t rem = 0;
+    mpd_size_t i;
+
+    assert(n > 0);
+
+    for (i=n-1; i != MPD_SIZE_MAX; i--) {
+        rem = _mpd_divstep_inv(&w[i], rem, u[i], MPD_RADIX, inv);
+    }
+
+    return rem >> inv->shift;
+}
+
+/*
+ * Inverse of a two-word binary divisor for _mpd_div3by2_inv(), Moller and
+ * Granlund, Algorithm 6. (d1, d0) is the divisor shifted left by 'shift'
+ * bits, so that the most significant bit of d1 is set.
+ */
+struct dword_inverse {
+    mpd_uint_t d1;
+    mpd_uint_t d0;
+    mpd_uint_t v;   /* floor((2**(3*N) - 1) / (d1, d0)) - 2**N */
+    int shift;
+};
+
+static void
+_mpd_init_dword_inverse(struct dword_inverse *inv, mpd_uint_t hi,
+                        mpd_uint_t lo)
+{
+    mpd_uint_t d1, d0, v, p, t1, t0;
+    int s;
+
+    assert(hi != 0);
+
+    s = MPD_BITS_PER_UINT - 1 - mpd_bsr(hi);
+    d1 = (hi << s) | ((lo >> 1) >> (MPD_BITS_PER_UINT - 1 - s));
+    d0 = lo << s;
+
+    _mpd_div_words(&v, &p, ~d1, MPD_UINT_MAX, d1);
+
+    p = d1 * v + d0;
+    if (p < d0) {
+        v--;
+        if (p >= d1) {
+            v--;
+            p -= d1;
         }
+        p -= d1;
     }
-    if (n >= MPD_MINALLOC_MAX) {
-        if ((v = mpd_alloc(n+1, sizeof *v)) == NULL) {
-            mpd_free(u);
-            return -1;
+
+    _mpd_mul_words(&t1, &t0, v, d0);
+    p += t1;
+    if (p < t1) {
+        v--;
+        if (p > d1 || (p == d1 && t0 >= d0)) {
+            v--;
         }
     }
 
-    _mpd_shortmul(u, uconst, nplusm, d);
-    _mpd_shortmul(v, vconst, n, d);
+    inv->d1 = d1;
+    inv->d0 = d0;
+    inv->v = v;
+    inv->shift = s;
+}
+
+/*
+ * Quotient of the three-word binary number (u2, u1, u0) divided by the
+ * normalized divisor (d1, d0). Moller and Granlund, Algorithm 5.
+ * Assumption: (u2, u1) < (d1, d0).
+ */
+static inline mpd_uint_t
+_mpd_div3by2_inv(mpd_uint_t u2, mpd_uint_t u1, mpd_uint_t u0,
+                 const struct dword_inverse *inv)
+{
+    mpd_uint_t q1, q0, r1, r0, t1, t0, b;
+
+    _mpd_mul_words(&q1, &q0, inv->v, u2);
+    q0 += u1;
+    q1 += u2 + (q0 < u1);
+
+    r1 = u1 - q1 * inv->d1;
+    _mpd_mul_words(&t1, &t0, inv->d0, q1);
+
+    /* (r1, r0) := (r1, u0) - (t1, t0) - (d1, d0) */
+    r0 = u0 - t0;
+    b = (u0 < t0);
+    r1 = r1 - t1 - b;
+    b = (r0 < inv->d0);
+    r0 -= inv->d0;
+    r1 = r1 - inv->d1 - b;
+
+    q1++;
+    if (r1 >= q0) {
+        q1--;
+        r0 += inv->d0;
+        r1 += inv->d1 + (r0 < inv->d0);
+    }
+    if (r1 > inv->d1 || (r1 == inv->d1 && r0 >= inv->d0)) {
+        q1++;
+    }
+
+    return q1;
+}
+
+/*
+ * Knuth, TAOCP Volume 2, 4.3.1, steps D2 to D7:
+ *     q := quotient of u (len nplusm+1) divided by v (len n+1)
+ *     u := remainder in u[0:n]
+ *     u and v are normalized by step D1, v[n] == 0, nplusm >= n > 1
+ */
+void
+_mpd_basedivmod_norm(mpd_uint_t *q, mpd_uint_t *u, const mpd_uint_t *v,
+                     mpd_size_t nplusm, mpd_size_t n)
+{
+    struct dword_inverse inv;
+    mpd_uint_t qhat;
+    mpd_uint_t hi, lo, x, u2, u1, u0;
+    mpd_uint_t carry;
+    mpd_size_t i, j, m;
+    int s;
+
+    assert(n > 1 && nplusm >= n);
+    m = sub_size_t(nplusm, n);
+
+    /* The upper two words of v as a binary number */
+    _mpd_mul_words(&hi, &lo, v[n-1], MPD_RADIX);
+    lo += v[n-2];
+    hi += (lo < v[n-2]);
+    _mpd_init_dword_inverse(&inv, hi, lo);
+    s = inv.shift;
 
     /* D2: loop */
     for (j=m; j != MPD_SIZE_MAX; j--) {
 
-        /* D3: calculate qhat and rhat */
-        rhat = _mpd_shortdiv(w2, u+j+n-1, 2, v[n-1]);
-        qhat = w2[1] * MPD_RADIX + w2[0];
-
-        while (1) {
-            if (qhat < MPD_RADIX) {
-                _mpd_singlemul(w2, qhat, v[n-2]);
-                if (w2[1] <= rhat) {
-                    if (w2[1] != rhat || w2[0] <= u[j+n-2]) {
-                        break;
-                    }
-                }
-            }
-            qhat -= 1;
-            rhat += v[n-1];
-            if (rhat < v[n-1] || rhat >= MPD_RADIX) {
-                break;
+        /* D3: calculate qhat. Knuth's estimate from the upper two words
+         * of u and the upper word of v, corrected by the second word of
+         * v, is min(MPD_RADIX-1, floor(U / V)), where U is the number
+         * formed by the upper three words of u and V the number formed by
+         * the upper two words of v. U and V are converted to binary and
+         * divided with the precomputed inverse of V.
+         */
+        if (u[j+n] == v[n-1] && u[j+n-1] == v[n-2]) {
+            qhat = MPD_RADIX-1;
+        }
+        else {
+            _mpd_mul_words(&hi, &lo, u[j+n], MPD_RADIX);
+            lo += u[j+n-1];
+            hi += (lo < u[j+n-1]);
+
+            _mpd_mul_words(&u1, &u0, lo, MPD_RADIX);
+            _mpd_mul_words(&u2, &x, hi, MPD_RADIX);
+            u1 += x;
+            u2 += (u1 < x);
+            u0 += u[j+n-2];
+            carry = (u0 < u[j+n-2]);
+            u1 += carry;
+            u2 += (u1 < carry);
+
+            if (s > 0) {
+                u2 = (u2 << s) | (u1 >> (MPD_BITS_PER_UINT - s));
+                u1 = (u1 << s) | (u0 >> (MPD_BITS_PER_UINT - s));
+                u0 = u0 << s;
             }
+
+            qhat = _mpd_div3by2_inv(u2, u1, u0, &inv);
         }
         /* D4: multiply and subtract */
         carry = 0;
@@ -378,6 +513,53 @@ _mpd_basedivmod(mpd_uint_t *q, mpd_uint_t *r,
             (void)_mpd_baseadd(u+j, u+j, v, n+1, n);
         }
     }
+}
+
+/*
+ * Knuth, TAOCP Volume 2, 4.3.1:
+ *     q, r := quotient and remainder of uconst (len nplusm)
+ *             divided by vconst (len n)
+ *     nplusm >= n
+ *
+ * If r is not NULL, r will contain the remainder. If r is NULL, the
+ * return value indicates if there is a remainder: 1 for true, 0 for
+ * false.  A return value of -1 indicates an error.
+ */
+int
+_mpd_basedivmod(mpd_uint_t *q, mpd_uint_t *r,
+                const mpd_uint_t *uconst, const mpd_uint_t *vconst,
+                mpd_size_t nplusm, mpd_size_t n)
+{
+    mpd_uint_t ustatic[MPD_MINALLOC_MAX];
+    mpd_uint_t vstatic[MPD_MINALLOC_MAX];
+    mpd_uint_t *u = ustatic;
+    mpd_uint_t *v = vstatic;
+    mpd_uint_t d;
+    mpd_size_t umark = 0, vmark = 0;
+    int retval = 0;
+
+    assert(n > 1 && nplusm >= n);
+
+    /* D1: normalize */
+    d = MPD_RADIX / (vconst[n-1] + 1);
+
+    if (nplusm >= MPD_MINALLOC_MAX) {
+        if ((u = _mpd_scratch_alloc(nplusm+1, &umark)) == NULL) {
+            return -1;
+        }
+    }
+    if (n >= MPD_MINALLOC_MAX) {
+        if ((v = _mpd_scratch_alloc(n+1, &vmark)) == NULL) {
+            if (u != ustatic) _mpd_scratch_free(u, umark);
+            return -1;
+        }
+    }
+
+    _mpd_shortmul(u, uconst, nplusm, d);
+    _mpd_shortmul(v, vconst, n, d);
+
+    /* D2-D7 */
+    _mpd_basedivmod_norm(q, u, v, nplusm, n);
 
     /* D8: unnormalize */
     if (r != NULL) {
@@ -390,8 +572,8 @@ _mpd_basedivmod(mpd_uint_t *q, mpd_uint_t *r,
     }
 
 
-if (u != ustatic) mpd_free(u);
-if (v != vstatic) mpd_free(v);
+if (u != ustatic) _mpd_scratch_free(u, umark);
+if (v != vstatic) _mpd_scratch_free(v, vmark);
 return retval;
 }
 
@@ -630,12 +812,18 @@ mpd_uint_t
 _mpd_shortdiv_b(mpd_uint_t *w, const mpd_uint_t *u, mpd_size_t n,
                 mpd_uint_t v, mpd_uint_t b)
 {
+    struct word_inverse inv;
     mpd_uint_t hi, lo;
     mpd_uint_t rem = 0;
     mpd_size_t i;
 
     assert(n > 0);
 
+    if (n > MPD_SHORTDIV_INV_MIN) {
+        _mpd_init_word_inverse(&inv, v);
+        return _mpd_shortdiv_inv_b(w, u, n, &inv, b);
+    }
+
     for (i=n-1; i != MPD_SIZE_MAX; i--) {
 
         _mpd_mul_words(&hi, &lo, rem, b);
@@ -647,3 +835,20 @@ _mpd_shortdiv_b(mpd_uint_t *w, const mpd_uint_t *u, mpd_size_t n,
 
     return rem;
 }
+
+/* Same as _mpd_shortdiv_b(), with the precomputed inverse of the divisor. */
+mpd_uint_t
+_mpd_shortdiv_inv_b(mpd_uint_t *w, const mpd_uint_t *u, mpd_size_t n,
+                    const struct word_inverse *inv, mpd_uint_t b)
+{
+    mpd_uint_t rem = 0;
+    mpd_size_t i;
+
+    assert(n > 0);
+
+    for (i=n-1; i != MPD_SIZE_MAX; i--) {
+        rem = _mpd_divstep_inv(&w[i], rem, u[i], b, inv);
+    }
+
+    return rem >> inv->shift;
+}
@@ -37,6 +37,25 @@
 MPD_PRAGMA(MPD_HIDE_SYMBOLS_START)
 
 
+/*
+ * Dividends of more words use a precomputed inverse in _mpd_shortdiv().
+ * A hardware division instruction is faster for short dividends.
+ */
+#if defined(ASM) || defined(MASM)
+  #define MPD_SHORTDIV_INV_MIN 16
+#else
+  #define MPD_SHORTDIV_INV_MIN 1
+#endif
+
+/* Precomputed inverse of a single word divisor d. */
+struct word_inverse {
+    mpd_uint_t d;     /* divisor */
+    mpd_uint_t dnorm; /* d << shift, most significant bit set */
+    mpd_uint_t v;     /* floor((2**(2*N) - 1) / dnorm) - 2**N */
+    int shift;
+};
+
+
 mpd_uint_t _mpd_baseadd(mpd_uint_t *w, const mpd_uint_t *u, const mpd_uint_t *v,
                         mpd_size_t m, mpd_size_t n);
 void _mpd_baseaddto(mpd_uint_t *w, const mpd_uint_t *u, mpd_size_t n);
@@ -59,6 +78,14 @@ mpd_uint_t _mpd_shortdiv(mpd_uint_t *w, const mpd_uint_t *u, mpd_size_t n,
                          mpd_uint_t v);
 mpd_uint_t _mpd_shortdiv_b(mpd_uint_t *w, const mpd_uint_t *u, mpd_size_t n,
                            mpd_uint_t v, mpd_uint_t b);
+mpd_uint_t _mpd_shortdiv_inv_b(mpd_uint_t *w, const mpd_uint_t *u,
+                               mpd_size_t n, const struct word_inverse *inv,
+                               mpd_uint_t b);
+void _mpd_init_word_inverse(struct word_inverse *inv, mpd_uint_t d);
+mpd_uint_t _mpd_shortdiv_inv(mpd_uint_t *w, const mpd_uint_t *u, mpd_size_t n,
+                             const struct word_inverse *inv);
+void _mpd_basedivmod_norm(mpd_uint_t *q, mpd_uint_t *u, const mpd_uint_t *v,
+                          mpd_size_t nplusm, mpd_size_t n);
 int _mpd_basedivmod(mpd_uint_t *q, mpd_uint_t *r, const mpd_uint_t *uconst,
                     const mpd_uint_t *vconst, mpd_size_t nplusm, mpd_size_t n);
 void _mpd_baseshiftl(mpd_uint_t *dest, mpd_uint_t *src, mpd_size_t n,
@@ -145,6 +172,61 @@ _mpd_div_words_r(mpd_uint_t *q, mpd_uint_t *r, mpd_uint_t hi, mpd_uint_t lo)
 #endif
 
 
+/*
+ * Divide the two-word number (hi, lo) by inv->dnorm, hi < inv->dnorm.
+ * Moller and Granlund, "Improved Division by Invariant Integers",
+ * Algorithm 4. Two multiplications and at most two corrections replace
+ * the hardware division.
+ */
+static inline void
+_mpd_div_words_inv(mpd_uint_t *q, mpd_uint_t *r, mpd_uint_t hi, mpd_uint_t lo,
+                   const struct word_inverse *inv)
+{
+    mpd_uint_t qh, ql, rem;
+
+    _mpd_mul_words(&qh, &ql, inv->v, hi);
+    ql = ql + lo;
+    if (ql < lo) qh++;
+    qh += hi + 1;
+
+    rem = lo - qh * inv->dnorm;
+    if (rem > ql) {
+        qh--;
+        rem += inv->dnorm;
+    }
+    if (rem >= inv->dnorm) {
+        qh++;
+        rem -= inv->dnorm;
+    }
+
+    *q = qh;
+    *r = rem;
+}
+
+/*
+ * One step of a division by a single word with a precomputed inverse:
+ * q := (rem * b + u) / inv->d. The remainder is kept shifted left by
+ * inv->shift, both on input and on return. Assumptions: rem < inv->d,
+ * u < b.
+ */
+static inline mpd_uint_t
+_mpd_divstep_inv(mpd_uint_t *q, mpd_uint_t rem, mpd_uint_t u, mpd_uint_t b,
+                 const struct word_inverse *inv)
+{
+    mpd_uint_t hi, lo, h, l;
+
+    _mpd_mul_words(&hi, &lo, rem, b);
+    l = u << inv->shift;
+    h = (u >> 1) >> (MPD_BITS_PER_UINT - 1 - inv->shift);
+    lo = l + lo;
+    if (lo < l) hi++;
+    hi += h;
+
+    _mpd_div_words_inv(q, &rem, hi, lo, inv);
+    return rem;
+}
+
+
 /* Multiply two single base MPD_RADIX words, store result in array w[2]. */
 static inline void
 _mpd_singlemul(mpd_uint_t w[2], mpd_uint_t u, mpd_uint_t v)
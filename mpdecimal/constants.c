@@ -44,6 +44,21 @@
   const mpd_uint_t LH_P1P2 = 18446744052234715137ULL;     /* (P1*P2) % 2^64 */
   const mpd_uint_t UH_P1P2 = 18446744052234715141ULL;     /* (P1*P2) / 2^64 */
 
+  /* explicit CRT: P/p[i] (low word first), its inverse mod p[i] and
+     floor(64 * 2^64 / p[i]), for P = P1*P2*P3 */
+  const mpd_uint_t mpd_crt_cofactors[3][2] = {
+    {18446742957018054657ULL, 18446742957018055681ULL},
+    {18446742969902956545ULL, 18446742969902956801ULL},
+    {18446744052234715137ULL, 18446744052234715141ULL}
+  };
+  const mpd_uint_t mpd_crt_inverses[3] = {
+    24113390934796885ULL, 18422343601451177389ULL, 287064143708160ULL
+  };
+  const mpd_uint_t mpd_crt_recip[3] = {64ULL, 64ULL, 64ULL};
+  const mpd_uint_t mpd_crt_modulus[3] = {  /* P, low word first */
+    18446742952723087361ULL, 18446737433690113286ULL, 18446742952723088646ULL
+  };
+
   /* transpose.c */
   const mpd_size_t mpd_bits[64] = {
     1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024,  2048, 4096, 8192, 16384,
@@ -94,6 +109,19 @@
   const mpd_uint_t LH_P1P2 = 4127195137UL;  /* (P1*P2) % 2^32 */
   const mpd_uint_t UH_P1P2 = 990904320UL;   /* (P1*P2) / 2^32 */
 
+  /* explicit CRT: P/p[i] (low word first), its inverse mod p[i] and
+     floor(64 * 2^32 / p[i]), for P = P1*P2*P3 */
+  const mpd_uint_t mpd_crt_cofactors[3][2] = {
+    {3825205249UL, 849346560UL},
+    {3925868545UL, 891813888UL},
+    {4127195137UL, 990904320UL}
+  };
+  const mpd_uint_t mpd_crt_inverses[3] = {147UL, 2013265721UL, 54UL};
+  const mpd_uint_t mpd_crt_recip[3] = {130UL, 136UL, 151UL};
+  const mpd_uint_t mpd_crt_modulus[3] = {  /* P, low word first */
+    1644167169UL, 2732064769UL, 418037760UL
+  };
+
   /* transpose.c */
   const mpd_size_t mpd_bits[32] = {
     1, 2, 4, 8, 16, 32, 64, 128, 256, 512,  1024,  2048, 4096, 8192, 16384,
@@ -127,3 +155,21 @@ const char * const mpd_clamp_string[MPD_CLAMP_GUARD] = {
     "CLAMP_DEFAULT",
     "CLAMP_IEEE_754"
 };
+
+const char * const mpd_tune_string[MPD_TUNE_GUARD] = {
+    "KARATSUBA_BASECASE",
+    "KARATSUBA_CUTOFF",
+    "TOOM3_BASECASE",
+    "TOOM_FNT_CUTOFF",
+    "SIX_STEP_THRESHOLD",
+    "POW2_CUTOFF",
+    "NEWTONDIV_CUTOFF",
+    "PARALLEL_FNT_CUTOFF",
+    "LOWMEM_FNT_CUTOFF",
+    "EXP_BSPLIT_CUTOFF",
+    "LN_AGM_CUTOFF",
+    "SQRT_COUPLED_CUTOFF",
+    "BZDIV_CUTOFF",
+    "BASECONV_CUTOFF",
+    "RECIPDIV_CUTOFF"
+};
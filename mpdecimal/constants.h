@@ -80,6 +80,10 @@ extern const mpd_uint_t INV_P1_MOD_P2;
 extern const mpd_uint_t INV_P1P2_MOD_P3;
 extern const mpd_uint_t LH_P1P2;
 extern const mpd_uint_t UH_P1P2;
+extern const mpd_uint_t mpd_crt_cofactors[3][2];
+extern const mpd_uint_t mpd_crt_inverses[3];
+extern const mpd_uint_t mpd_crt_recip[3];
+extern const mpd_uint_t mpd_crt_modulus[3];
 
 
 MPD_PRAGMA(MPD_HIDE_SYMBOLS_END) /* restore previous scope rules */
@@ -29,8 +29,10 @@
 #include "constants.h"
 #include "convolute.h"
 #include "fnt.h"
+#include "fntsimd.h"
 #include "fourstep.h"
 #include "mpdecimal.h"
+#include "mptune.h"
 #include "numbertheory.h"
 #include "sixstep.h"
 #include "umodarith.h"
@@ -42,12 +44,34 @@
  */
 
 
-/* Convolute the data in c1 and c2. Result is in c1. */
-int
-fnt_convolute(mpd_uint_t *c1, mpd_uint_t *c2, mpd_size_t n, int modnum)
+typedef int (*fnt_func)(mpd_uint_t *, mpd_size_t, int);
+
+static inline void
+fnt_select(mpd_size_t n, fnt_func *fnt, fnt_func *inv_fnt)
 {
-    int (*fnt)(mpd_uint_t *, mpd_size_t, int);
-    int (*inv_fnt)(mpd_uint_t *, mpd_size_t, int);
+    if (ispower2(n)) {
+        if (n > MPD_SIX_STEP_THRESHOLD) {
+            *fnt = six_step_fnt;
+            *inv_fnt = inv_six_step_fnt;
+        }
+        else {
+            *fnt = std_fnt;
+            *inv_fnt = std_inv_fnt;
+        }
+    }
+    else {
+        *fnt = four_step_fnt;
+        *inv_fnt = inv_four_step_fnt;
+    }
+}
+
+/* Multiply the transforms in c1 and c2 pointwise, then transform back.
+   c2 may be equal to c1. Result is in c1. */
+static int
+fnt_pointwise_inverse(mpd_uint_t *c1, const mpd_uint_t *c2, mpd_size_t n,
+                      int modnum)
+{
+    fnt_func fnt, inv_fnt;
 #ifdef PPRO
     double dmod;
     uint32_t dinvmod[3];
@@ -59,114 +83,97 @@ fnt_convolute(mpd_uint_t *c1, mpd_uint_t *c2, mpd_size_t n, int modnum)
     SETMODULUS(modnum);
     n_inv = POWMOD(n, (umod-2));
 
-    if (ispower2(n)) {
-        if (n > SIX_STEP_THRESHOLD) {
-            fnt = six_step_fnt;
-            inv_fnt = inv_six_step_fnt;
-        }
-        else {
-            fnt = std_fnt;
-            inv_fnt = std_inv_fnt;
-        }
-    }
-    else {
-        fnt = four_step_fnt;
-        inv_fnt = inv_four_step_fnt;
-    }
+    fnt_select(n, &fnt, &inv_fnt);
 
-    if (!fnt(c1, n, modnum)) {
-        return 0;
-    }
-    if (!fnt(c2, n, modnum)) {
-        return 0;
+#ifdef MPD_FNT_SIMD
+    if (_mpd_simd.mulmod != NULL) {
+        _mpd_simd.mulmod(c1, c2, n, modnum);
     }
-    for (i = 0; i < n-1; i += 2) {
-        mpd_uint_t x0 = c1[i];
-        mpd_uint_t y0 = c2[i];
-        mpd_uint_t x1 = c1[i+1];
-        mpd_uint_t y1 = c2[i+1];
-        MULMOD2(&x0, y0, &x1, y1);
-        c1[i] = x0;
-        c1[i+1] = x1;
+    else
+#endif
+    {
+        for (i = 0; i < n-1; i += 2) {
+            mpd_uint_t x0 = c1[i];
+            mpd_uint_t y0 = c2[i];
+            mpd_uint_t x1 = c1[i+1];
+            mpd_uint_t y1 = c2[i+1];
+            MULMOD2(&x0, y0, &x1, y1);
+            c1[i] = x0;
+            c1[i+1] = x1;
+        }
     }
 
     if (!inv_fnt(c1, n, modnum)) {
         return 0;
     }
-    for (i = 0; i < n-3; i += 4) {
-        mpd_uint_t x0 = c1[i];
-        mpd_uint_t x1 = c1[i+1];
-        mpd_uint_t x2 = c1[i+2];
-        mpd_uint_t x3 = c1[i+3];
-        MULMOD2C(&x0, &x1, n_inv);
-        MULMOD2C(&x2, &x3, n_inv);
-        c1[i] = x0;
-        c1[i+1] = x1;
-        c1[i+2] = x2;
-        c1[i+3] = x3;
+#ifdef MPD_FNT_SIMD
+    if (_mpd_simd.mulmod_c != NULL) {
+        _mpd_simd.mulmod_c(c1, n_inv, n, modnum);
+    }
+    else
+#endif
+    {
+        for (i = 0; i < n-3; i += 4) {
+            mpd_uint_t x0 = c1[i];
+            mpd_uint_t x1 = c1[i+1];
+            mpd_uint_t x2 = c1[i+2];
+            mpd_uint_t x3 = c1[i+3];
+            MULMOD2C(&x0, &x1, n_inv);
+            MULMOD2C(&x2, &x3, n_inv);
+            c1[i] = x0;
+            c1[i+1] = x1;
+            c1[i+2] = x2;
+            c1[i+3] = x3;
+        }
     }
 
     return 1;
 }
 
-/* Autoconvolute the data in c1. Result is in c1. */
+/* Forward transform of the data in c. Result is in c. */
 int
-fnt_autoconvolute(mpd_uint_t *c1, mpd_size_t n, int modnum)
+fnt_forward(mpd_uint_t *c, mpd_size_t n, int modnum)
 {
-    int (*fnt)(mpd_uint_t *, mpd_size_t, int);
-    int (*inv_fnt)(mpd_uint_t *, mpd_size_t, int);
-#ifdef PPRO
-    double dmod;
-    uint32_t dinvmod[3];
-#endif
-    mpd_uint_t n_inv, umod;
-    mpd_size_t i;
-
+    fnt_func fnt, inv_fnt;
 
-    SETMODULUS(modnum);
-    n_inv = POWMOD(n, (umod-2));
+    fnt_select(n, &fnt, &inv_fnt);
+    return fnt(c, n, modnum);
+}
 
-    if (ispower2(n)) {
-        if (n > SIX_STEP_THRESHOLD) {
-            fnt = six_step_fnt;
-            inv_fnt = inv_six_step_fnt;
-        }
-        else {
-            fnt = std_fnt;
-            inv_fnt = std_inv_fnt;
-        }
+/* Convolute the data in c1 and c2. Result is in c1. */
+int
+fnt_convolute(mpd_uint_t *c1, mpd_uint_t *c2, mpd_size_t n, int modnum)
+{
+    if (!fnt_forward(c1, n, modnum)) {
+        return 0;
     }
-    else {
-        fnt = four_step_fnt;
-        inv_fnt = inv_four_step_fnt;
+    if (!fnt_forward(c2, n, modnum)) {
+        return 0;
     }
 
-    if (!fnt(c1, n, modnum)) {
+    return fnt_pointwise_inverse(c1, c2, n, modnum);
+}
+
+/* Convolute the data in c1 and the data whose forward transform is in c2.
+   Result is in c1. */
+int
+fnt_convolute_trans(mpd_uint_t *c1, const mpd_uint_t *c2, mpd_size_t n,
+                    int modnum)
+{
+    if (!fnt_forward(c1, n, modnum)) {
         return 0;
     }
-    for (i = 0; i < n-1; i += 2) {
-        mpd_uint_t x0 = c1[i];
-        mpd_uint_t x1 = c1[i+1];
-        MULMOD2(&x0, x0, &x1, x1);
-        c1[i] = x0;
-        c1[i+1] = x1;
-    }
 
-    if (!inv_fnt(c1, n, modnum)) {
+    return fnt_pointwise_inverse(c1, c2, n, modnum);
+}
+
+/* Autoconvolute the data in c1. Result is in c1. */
+int
+fnt_autoconvolute(mpd_uint_t *c1, mpd_size_t n, int modnum)
+{
+    if (!fnt_forward(c1, n, modnum)) {
         return 0;
     }
-    for (i = 0; i < n-3; i += 4) {
-        mpd_uint_t x0 = c1[i];
-        mpd_uint_t x1 = c1[i+1];
-        mpd_uint_t x2 = c1[i+2];
-        mpd_uint_t x3 = c1[i+3];
-        MULMOD2C(&x0, &x1, n_inv);
-        MULMOD2C(&x2, &x3, n_inv);
-        c1[i] = x0;
-        c1[i+1] = x1;
-        c1[i+2] = x2;
-        c1[i+3] = x3;
-    }
 
-    return 1;
+    return fnt_pointwise_inverse(c1, c1, n, modnum);
 }
@@ -36,9 +36,9 @@
 MPD_PRAGMA(MPD_HIDE_SYMBOLS_START)
 
 
-#define SIX_STEP_THRESHOLD 4096
-
+int fnt_forward(mpd_uint_t *c, mpd_size_t n, int modnum);
 int fnt_convolute(mpd_uint_t *c1, mpd_uint_t *c2, mpd_size_t n, int modnum);
+int fnt_convolute_trans(mpd_uint_t *c1, const mpd_uint_t *c2, mpd_size_t n, int modnum);
 int fnt_autoconvolute(mpd_uint_t *c1, mpd_size_t n, int modnum);
 
 
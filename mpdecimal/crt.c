@@ -176,3 +176,159 @@ crt3(mpd_uint_t *x1, mpd_uint_t *x2, mpd_uint_t *x3, mpd_size_t rsize)
 
     assert(carry[0] == 0 && carry[1] == 0 && carry[2] == 0);
 }
+
+
+/*
+ * Explicit CRT, for multiplications that compute the convolutions for the
+ * three moduli one after the other. Let P = p1*p2*p3, Q[k] = P/p[k] and
+ * a[k] = x[k] * Q[k]**-1 mod p[k] for the residues x[k] of a member z of
+ * the exact convolution. Then
+ *
+ *   z = a[1]*Q[1] + a[2]*Q[2] + a[3]*Q[3] - h*P,
+ *
+ *   h = floor(a[1]/p[1] + a[2]/p[2] + a[3]/p[3]) <= 2.
+ *
+ * The sum of the fractions is h + z/P, and z/P is tiny, so h can be found
+ * from the sum of 6-bit approximations of the fractions, which fit in a
+ * byte for all three moduli.
+ *
+ * The terms a[k]*Q[k] are linear, so crt_add() can add them to the final
+ * result as soon as the convolution for p[k] is available. Only the
+ * approximations are kept per member, and crt_finish() subtracts h*P.
+ * The result has MPD_CRT_EXTRA more words than the product, which are
+ * zero after crt_finish().
+ */
+
+/* Multiply the two words in u by v, store result in w. */
+static inline void
+_crt_mul2_3(mpd_uint_t w[3], const mpd_uint_t u[2], mpd_uint_t v)
+{
+    mpd_uint_t hi1, hi2, lo;
+
+    _mpd_mul_words(&hi1, &lo, u[0], v);
+    w[0] = lo;
+
+    _mpd_mul_words(&hi2, &lo, u[1], v);
+    lo = hi1 + lo;
+    if (lo < hi1) hi2++;
+
+    w[1] = lo;
+    w[2] = hi2;
+}
+
+/*
+ * Subtract the three words in t from the word *d < MPD_RADIX, borrowing
+ * from the following words. Store the new value of *d and the amount to
+ * be borrowed in t.
+ */
+static inline void
+_crt_sub3(mpd_uint_t *d, mpd_uint_t t[3])
+{
+    mpd_uint_t r;
+
+    if (t[2] == 0 && t[1] == 0 && t[0] <= *d) {
+        *d -= t[0];
+        t[0] = 0;
+        return;
+    }
+
+    /* t = t - *d > 0 */
+    if (t[0] < *d) {
+        if (t[1]-- == 0) t[2]--;
+    }
+    t[0] -= *d;
+
+    r = _crt_div3(t, t, MPD_RADIX);
+    if (r == 0) {
+        *d = 0;
+    }
+    else {
+        *d = MPD_RADIX - r;
+        if (++t[0] == 0 && ++t[1] == 0) t[2]++;
+    }
+}
+
+/*
+ * Add a[k]*Q[k]*MPD_RADIX**i to w for all members x[i] of the convolution
+ * for modnum, and add the approximations of a[k]/p[k] to frac. w has
+ * rsize+MPD_CRT_EXTRA words, w and frac are zero before the first call.
+ */
+void
+crt_add(mpd_uint_t *w, unsigned char *frac, const mpd_uint_t *x,
+        mpd_size_t rsize, int modnum)
+{
+    const mpd_uint_t *q = mpd_crt_cofactors[modnum];
+    mpd_uint_t inv = mpd_crt_inverses[modnum];
+    mpd_uint_t recip = mpd_crt_recip[modnum];
+    mpd_uint_t umod;
+#ifdef PPRO
+    double dmod;
+    uint32_t dinvmod[3];
+#endif
+    mpd_uint_t a;
+    mpd_uint_t t[3];
+    mpd_uint_t carry[3] = {0,0,0};
+    mpd_uint_t hi, lo;
+    mpd_size_t i;
+
+    SETMODULUS(modnum);
+
+    for (i = 0; i < rsize; i++) {
+        a = MULMOD(x[i], inv);
+
+        _mpd_mul_words(&hi, &lo, a, recip);
+        frac[i] += (unsigned char)hi;
+
+        _crt_mul2_3(t, q, a);
+        _crt_add3(carry, t);
+        t[0] = w[i]; t[1] = 0; t[2] = 0;
+        _crt_add3(carry, t);
+
+        w[i] = _crt_div3(carry, carry, MPD_RADIX);
+    }
+
+    for (; i < rsize+MPD_CRT_EXTRA; i++) {
+        t[0] = w[i]; t[1] = 0; t[2] = 0;
+        _crt_add3(carry, t);
+        w[i] = _crt_div3(carry, carry, MPD_RADIX);
+    }
+
+    assert(carry[0] == 0 && carry[1] == 0 && carry[2] == 0);
+}
+
+/* Subtract h*P*MPD_RADIX**i from w for all members of the convolution. */
+void
+crt_finish(mpd_uint_t *w, const unsigned char *frac, mpd_size_t rsize)
+{
+    mpd_uint_t borrow[3] = {0,0,0};
+    mpd_uint_t t[3];
+    unsigned int h;
+    mpd_size_t i;
+
+    for (i = 0; i < rsize; i++) {
+        h = ((unsigned int)frac[i] + 32) >> 6;
+        assert(h <= 2);
+
+        if (h > 0) {
+            t[0] = mpd_crt_modulus[0];
+            t[1] = mpd_crt_modulus[1];
+            t[2] = mpd_crt_modulus[2];
+            _crt_add3(borrow, t);
+        }
+        _crt_sub3(&w[i], borrow);
+
+        if (h > 1) {
+            t[0] = mpd_crt_modulus[0];
+            t[1] = mpd_crt_modulus[1];
+            t[2] = mpd_crt_modulus[2];
+            _crt_sub3(&w[i], t);
+            _crt_add3(borrow, t);
+        }
+    }
+
+    for (; i < rsize+MPD_CRT_EXTRA; i++) {
+        _crt_sub3(&w[i], borrow);
+    }
+
+    assert(borrow[0] == 0 && borrow[1] == 0 && borrow[2] == 0);
+}
@@ -36,7 +36,14 @@
 MPD_PRAGMA(MPD_HIDE_SYMBOLS_START)
 
 
+/* words of the result of crt_add() beyond the size of the product */
+#define MPD_CRT_EXTRA 3
+
+
 void crt3(mpd_uint_t *x1, mpd_uint_t *x2, mpd_uint_t *x3, mpd_size_t rsize);
+void crt_add(mpd_uint_t *w, unsigned char *frac, const mpd_uint_t *x,
+             mpd_size_t rsize, int modnum);
+void crt_finish(mpd_uint_t *w, const unsigned char *frac, mpd_size_t rsize);
 
 
 MPD_PRAGMA(MPD_HIDE_SYMBOLS_END) /* restore previous scope rules */
@@ -30,6 +30,7 @@
 #include "bits.h"
 #include "constants.h"
 #include "difradix2.h"
+#include "fntsimd.h"
 #include "mpdecimal.h"
 #include "numbertheory.h"
 #include "umodarith.h"
@@ -87,6 +88,14 @@ fnt_dif2(mpd_uint_t a[], mpd_size_t n, struct fnt_params *tparams)
     assert(ispower2(n));
     assert(n >= 4);
 
+#ifdef MPD_FNT_SIMD
+    if (_mpd_simd.dif2 != NULL) {
+        _mpd_simd.dif2(a, n, tparams);
+        bitreverse_permute(a, n);
+        return;
+    }
+#endif
+
     SETMODULUS(tparams->modnum);
 
     /* m == n */
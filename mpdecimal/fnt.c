@@ -48,12 +48,12 @@ std_fnt(mpd_uint_t *a, mpd_size_t n, int modnum)
     assert(n >= 4);
     assert(n <= 3*MPD_MAXTRANSFORM_2N);
 
-    if ((tparams = _mpd_init_fnt_params(n, -1, modnum)) == NULL) {
+    if ((tparams = _mpd_get_fnt_params(n, -1, modnum)) == NULL) {
         return 0;
     }
     fnt_dif2(a, n, tparams);
 
-    mpd_free(tparams);
+    _mpd_release_fnt_params(tparams);
     return 1;
 }
 
@@ -67,11 +67,11 @@ std_inv_fnt(mpd_uint_t *a, mpd_size_t n, int modnum)
     assert(n >= 4);
     assert(n <= 3*MPD_MAXTRANSFORM_2N);
 
-    if ((tparams = _mpd_init_fnt_params(n, 1, modnum)) == NULL) {
+    if ((tparams = _mpd_get_fnt_params(n, 1, modnum)) == NULL) {
         return 0;
     }
     fnt_dif2(a, n, tparams);
 
-    mpd_free(tparams);
+    _mpd_release_fnt_params(tparams);
     return 1;
 }
@@ -0,0 +1,508 @@
+/*
+ * Copyright (c) 2026 Iain Buclaw.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+
+
+#include "mpdecimal.h"
+#include "fntsimd.h"
+
+#ifdef MPD_FNT_SIMD
+
+#include <immintrin.h>
+#include <stdint.h>
+
+#include "constants.h"
+#include "numbertheory.h"
+#include "umodarith.h"
+
+
+/*
+ * Bignum: Vectorized butterflies and pointwise multiplication for the
+ * three moduli p = 2**64 - 2**k + 1 (k = 32, 34, 40).
+ *
+ * The 128-bit products are assembled from four 32x32->64 bit
+ * multiplications. The reduction is the one from x64_mulmod(), applied
+ * to all lanes at once:
+ *
+ *   hi * 2**64 + lo  ==  (hi >> (64-k)) * 2**64 + (hi << k) + lo - hi
+ *
+ * is repeated until hi * 2**64 + lo < 2*p (two rounds for P1, three for
+ * P2 and P3), followed by one conditional subtraction. The results are
+ * fully reduced, so they are identical to those of the scalar code.
+ */
+
+
+/* shift k and number of reduction rounds for each modulus */
+static const int mod_shift[3] = {32, 34, 40};
+static const int mod_rounds[3] = {2, 3, 3};
+
+
+/******************************************************************************/
+/*                              Scalar fallback                               */
+/******************************************************************************/
+
+/* Stages of fnt_dif2() with m, m/2, ..., 2. Used for the stages that are
+   too short for the vector width. */
+static void
+dif2_stages(mpd_uint_t a[], mpd_size_t n, mpd_size_t m, mpd_size_t wstep,
+            const mpd_uint_t *wtable, mpd_uint_t umod)
+{
+    mpd_uint_t u, v;
+    mpd_size_t mhalf, j, r;
+
+    for (; m >= 2; m >>= 1, wstep <<= 1) {
+        mhalf = m / 2;
+        for (j = 0; j < mhalf; j++) {
+            mpd_uint_t w = wtable[j*wstep];
+            for (r = 0; r < n; r += m) {
+                u = a[r+j];
+                v = a[r+j+mhalf];
+                a[r+j] = addmod(u, v, umod);
+                v = submod(u, v, umod);
+                a[r+j+mhalf] = (j == 0) ? v : x64_mulmod(v, w, umod);
+            }
+        }
+    }
+}
+
+
+/******************************************************************************/
+/*                                    AVX2                                    */
+/******************************************************************************/
+
+#define MPD_AVX2 __attribute__((target("avx2")))
+
+struct avx2_mod {
+    __m256i m;
+    __m256i k;      /* shift left */
+    __m256i s;      /* shift right: 64 - k */
+    int rounds;
+};
+
+static inline MPD_AVX2 void
+avx2_setmod(struct avx2_mod *mod, int modnum)
+{
+    mod->m = _mm256_set1_epi64x((long long)mpd_moduli[modnum]);
+    mod->k = _mm256_set1_epi64x(mod_shift[modnum]);
+    mod->s = _mm256_set1_epi64x(64-mod_shift[modnum]);
+    mod->rounds = mod_rounds[modnum];
+}
+
+/* unsigned a > b: all ones or zero */
+static inline MPD_AVX2 __m256i
+avx2_cmpgt_u64(__m256i a, __m256i b)
+{
+    const __m256i sign = _mm256_set1_epi64x(INT64_MIN);
+    return _mm256_cmpgt_epi64(_mm256_xor_si256(a, sign),
+                              _mm256_xor_si256(b, sign));
+}
+
+/* Restrictions: a < m and b < m */
+static inline MPD_AVX2 __m256i
+avx2_submod(__m256i a, __m256i b, __m256i m)
+{
+    __m256i d = _mm256_sub_epi64(a, b);
+    return _mm256_add_epi64(d, _mm256_and_si256(avx2_cmpgt_u64(b, a), m));
+}
+
+/* Restrictions: a < m and b < m. a + b == a - (m - b) (mod m) */
+static inline MPD_AVX2 __m256i
+avx2_addmod(__m256i a, __m256i b, __m256i m)
+{
+    return avx2_submod(a, _mm256_sub_epi64(m, b), m);
+}
+
+/* Restrictions: a < m and b < m */
+static inline MPD_AVX2 __m256i
+avx2_mulmod(__m256i a, __m256i b, const struct avx2_mod *mod)
+{
+    const __m256i mask32 = _mm256_set1_epi64x(0xffffffff);
+    __m256i ah, bh, ll, lh, hl, hh, mid, hi, lo, x, y, t;
+    int i;
+
+    ah = _mm256_srli_epi64(a, 32);
+    bh = _mm256_srli_epi64(b, 32);
+    ll = _mm256_mul_epu32(a, b);
+    lh = _mm256_mul_epu32(a, bh);
+    hl = _mm256_mul_epu32(ah, b);
+    hh = _mm256_mul_epu32(ah, bh);
+
+    mid = _mm256_add_epi64(_mm256_srli_epi64(ll, 32),
+                           _mm256_and_si256(lh, mask32));
+    mid = _mm256_add_epi64(mid, _mm256_and_si256(hl, mask32));
+    lo = _mm256_blend_epi32(ll, _mm256_slli_epi64(mid, 32), 0xaa);
+    hi = _mm256_add_epi64(hh, _mm256_srli_epi64(lh, 32));
+    hi = _mm256_add_epi64(hi, _mm256_srli_epi64(hl, 32));
+    hi = _mm256_add_epi64(hi, _mm256_srli_epi64(mid, 32));
+
+    for (i = 0; i < mod->rounds; i++) {
+        x = _mm256_sub_epi64(lo, hi);
+        t = avx2_cmpgt_u64(hi, lo);             /* borrow */
+        y = _mm256_sllv_epi64(hi, mod->k);
+        hi = _mm256_add_epi64(_mm256_srlv_epi64(hi, mod->s), t);
+        lo = _mm256_add_epi64(y, x);
+        t = avx2_cmpgt_u64(y, lo);              /* carry */
+        hi = _mm256_sub_epi64(hi, t);
+    }
+
+    /* hi || lo >= m ? lo - m : lo */
+    t = _mm256_and_si256(avx2_cmpgt_u64(mod->m, lo),
+                         _mm256_cmpeq_epi64(hi, _mm256_setzero_si256()));
+    return _mm256_blendv_epi8(_mm256_sub_epi64(lo, mod->m), lo, t);
+}
+
+/* One stage of fnt_dif2() with m >= 8. */
+static MPD_AVX2 void
+avx2_dif2_stage(mpd_uint_t a[], mpd_size_t n, mpd_size_t m, mpd_size_t wstep,
+                const mpd_uint_t *wtable, const struct avx2_mod *mod)
+{
+    mpd_size_t mhalf = m / 2;
+    mpd_size_t j, r;
+    __m256i idx, istep, w, u, v;
+
+    idx = _mm256_set_epi64x(3*wstep, 2*wstep, wstep, 0);
+    istep = _mm256_set1_epi64x(4*wstep);
+
+    for (j = 0; j < mhalf; j += 4) {
+        if (wstep == 1) {
+            w = _mm256_loadu_si256((const __m256i *)(wtable+j));
+        }
+        else {
+            w = _mm256_i64gather_epi64((const long long *)wtable, idx, 8);
+            idx = _mm256_add_epi64(idx, istep);
+        }
+        for (r = 0; r < n; r += m) {
+            mpd_uint_t *p0 = a+r+j;
+            mpd_uint_t *p1 = p0+mhalf;
+            u = _mm256_loadu_si256((const __m256i *)p0);
+            v = _mm256_loadu_si256((const __m256i *)p1);
+            _mm256_storeu_si256((__m256i *)p0, avx2_addmod(u, v, mod->m));
+            v = avx2_submod(u, v, mod->m);
+            _mm256_storeu_si256((__m256i *)p1, avx2_mulmod(v, w, mod));
+        }
+    }
+}
+
+/* The last two stages of fnt_dif2() (m == 4 and m == 2), eight words at a
+   time. Restrictions: n >= 8 */
+static MPD_AVX2 void
+avx2_dif2_tail(mpd_uint_t a[], mpd_size_t n, const mpd_uint_t *wtable,
+               const struct avx2_mod *mod)
+{
+    __m256i w, x, y, u, v;
+    mpd_size_t r;
+
+    /* m == 4: butterflies (r, r+2) and (r+1, r+3) */
+    w = _mm256_set_epi64x((long long)wtable[n/4], 1,
+                          (long long)wtable[n/4], 1);
+    for (r = 0; r < n; r += 8) {
+        x = _mm256_loadu_si256((const __m256i *)(a+r));
+        y = _mm256_loadu_si256((const __m256i *)(a+r+4));
+        u = _mm256_permute2x128_si256(x, y, 0x20);
+        v = _mm256_permute2x128_si256(x, y, 0x31);
+        x = avx2_addmod(u, v, mod->m);
+        y = avx2_mulmod(avx2_submod(u, v, mod->m), w, mod);
+        _mm256_storeu_si256((__m256i *)(a+r),
+                            _mm256_permute2x128_si256(x, y, 0x20));
+        _mm256_storeu_si256((__m256i *)(a+r+4),
+                            _mm256_permute2x128_si256(x, y, 0x31));
+    }
+
+    /* m == 2: butterflies (r, r+1), the twiddle factor is 1 */
+    for (r = 0; r < n; r += 8) {
+        x = _mm256_loadu_si256((const __m256i *)(a+r));
+        y = _mm256_loadu_si256((const __m256i *)(a+r+4));
+        u = _mm256_unpacklo_epi64(x, y);
+        v = _mm256_unpackhi_epi64(x, y);
+        x = avx2_addmod(u, v, mod->m);
+        y = avx2_submod(u, v, mod->m);
+        _mm256_storeu_si256((__m256i *)(a+r), _mm256_unpacklo_epi64(x, y));
+        _mm256_storeu_si256((__m256i *)(a+r+4), _mm256_unpackhi_epi64(x, y));
+    }
+}
+
+static MPD_AVX2 void
+avx2_dif2(mpd_uint_t a[], mpd_size_t n, const struct fnt_params *tparams)
+{
+    struct avx2_mod mod;
+    mpd_size_t m, wstep;
+
+    avx2_setmod(&mod, tparams->modnum);
+
+    for (m = n, wstep = 1; m >= 8; m >>= 1, wstep <<= 1) {
+        avx2_dif2_stage(a, n, m, wstep, tparams->wtable, &mod);
+    }
+
+    if (n >= 8) {
+        avx2_dif2_tail(a, n, tparams->wtable, &mod);
+    }
+    else {
+        dif2_stages(a, n, m, wstep, tparams->wtable, tparams->modulus);
+    }
+}
+
+static MPD_AVX2 void
+avx2_mulmod_vec(mpd_uint_t *c1, const mpd_uint_t *c2, mpd_size_t n,
+                int modnum)
+{
+    struct avx2_mod mod;
+    mpd_size_t i;
+
+    avx2_setmod(&mod, modnum);
+
+    for (i = 0; i+4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(c1+i));
+        __m256i y = _mm256_loadu_si256((const __m256i *)(c2+i));
+        _mm256_storeu_si256((__m256i *)(c1+i), avx2_mulmod(x, y, &mod));
+    }
+    for (; i < n; i++) {
+        c1[i] = x64_mulmod(c1[i], c2[i], mpd_moduli[modnum]);
+    }
+}
+
+static MPD_AVX2 void
+avx2_mulmod_c(mpd_uint_t *c, mpd_uint_t w, mpd_size_t n, int modnum)
+{
+    struct avx2_mod mod;
+    __m256i y;
+    mpd_size_t i;
+
+    avx2_setmod(&mod, modnum);
+    y = _mm256_set1_epi64x((long long)w);
+
+    for (i = 0; i+4 <= n; i += 4) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(c+i));
+        _mm256_storeu_si256((__m256i *)(c+i), avx2_mulmod(x, y, &mod));
+    }
+    for (; i < n; i++) {
+        c[i] = x64_mulmod(c[i], w, mpd_moduli[modnum]);
+    }
+}
+
+
+/******************************************************************************/
+/*                                  AVX-512                                   */
+/******************************************************************************/
+
+#define MPD_AVX512 __attribute__((target("avx2,avx512f")))
+
+struct avx512_mod {
+    __m512i m;
+    __m512i k;
+    __m512i s;
+    int rounds;
+};
+
+static inline MPD_AVX512 void
+avx512_setmod(struct avx512_mod *mod, int modnum)
+{
+    mod->m = _mm512_set1_epi64((long long)mpd_moduli[modnum]);
+    mod->k = _mm512_set1_epi64(mod_shift[modnum]);
+    mod->s = _mm512_set1_epi64(64-mod_shift[modnum]);
+    mod->rounds = mod_rounds[modnum];
+}
+
+/* Restrictions: a < m and b < m */
+static inline MPD_AVX512 __m512i
+avx512_submod(__m512i a, __m512i b, __m512i m)
+{
+    __m512i d = _mm512_sub_epi64(a, b);
+    return _mm512_mask_add_epi64(d, _mm512_cmplt_epu64_mask(a, b), d, m);
+}
+
+/* Restrictions: a < m and b < m */
+static inline MPD_AVX512 __m512i
+avx512_addmod(__m512i a, __m512i b, __m512i m)
+{
+    return avx512_submod(a, _mm512_sub_epi64(m, b), m);
+}
+
+/* Restrictions: a < m and b < m */
+static inline MPD_AVX512 __m512i
+avx512_mulmod(__m512i a, __m512i b, const struct avx512_mod *mod)
+{
+    const __m512i mask32 = _mm512_set1_epi64(0xffffffff);
+    const __m512i one = _mm512_set1_epi64(1);
+    __m512i ah, bh, ll, lh, hl, hh, mid, hi, lo, x, y;
+    __mmask8 t;
+    int i;
+
+    ah = _mm512_srli_epi64(a, 32);
+    bh = _mm512_srli_epi64(b, 32);
+    ll = _mm512_mul_epu32(a, b);
+    lh = _mm512_mul_epu32(a, bh);
+    hl = _mm512_mul_epu32(ah, b);
+    hh = _mm512_mul_epu32(ah, bh);
+
+    mid = _mm512_add_epi64(_mm512_srli_epi64(ll, 32),
+                           _mm512_and_si512(lh, mask32));
+    mid = _mm512_add_epi64(mid, _mm512_and_si512(hl, mask32));
+    lo = _mm512_mask_blend_epi32(0xaaaa, ll, _mm512_slli_epi64(mid, 32));
+    hi = _mm512_add_epi64(hh, _mm512_srli_epi64(lh, 32));
+    hi = _mm512_add_epi64(hi, _mm512_srli_epi64(hl, 32));
+    hi = _mm512_add_epi64(hi, _mm512_srli_epi64(mid, 32));
+
+    for (i = 0; i < mod->rounds; i++) {
+        x = _mm512_sub_epi64(lo, hi);
+        t = _mm512_cmplt_epu64_mask(lo, hi);    /* borrow */
+        y = _mm512_sllv_epi64(hi, mod->k);
+        hi = _mm512_srlv_epi64(hi, mod->s);
+        hi = _mm512_mask_sub_epi64(hi, t, hi, one);
+        lo = _mm512_add_epi64(y, x);
+        t = _mm512_cmplt_epu64_mask(lo, y);     /* carry */
+        hi = _mm512_mask_add_epi64(hi, t, hi, one);
+    }
+
+    /* hi || lo >= m ? lo - m : lo */
+    t = _mm512_cmpge_epu64_mask(lo, mod->m) |
+        _mm512_test_epi64_mask(hi, hi);
+    return _mm512_mask_sub_epi64(lo, t, lo, mod->m);
+}
+
+/* One stage of fnt_dif2() with m >= 16. */
+static MPD_AVX512 void
+avx512_dif2_stage(mpd_uint_t a[], mpd_size_t n, mpd_size_t m, mpd_size_t wstep,
+                  const mpd_uint_t *wtable, const struct avx512_mod *mod)
+{
+    mpd_size_t mhalf = m / 2;
+    mpd_size_t j, r;
+    __m512i idx, istep, w, u, v;
+
+    idx = _mm512_set_epi64(7*wstep, 6*wstep, 5*wstep, 4*wstep,
+                           3*wstep, 2*wstep, wstep, 0);
+    istep = _mm512_set1_epi64(8*wstep);
+
+    for (j = 0; j < mhalf; j += 8) {
+        if (wstep == 1) {
+            w = _mm512_loadu_si512(wtable+j);
+        }
+        else {
+            w = _mm512_i64gather_epi64(idx, wtable, 8);
+            idx = _mm512_add_epi64(idx, istep);
+        }
+        for (r = 0; r < n; r += m) {
+            mpd_uint_t *p0 = a+r+j;
+            mpd_uint_t *p1 = p0+mhalf;
+            u = _mm512_loadu_si512(p0);
+            v = _mm512_loadu_si512(p1);
+            _mm512_storeu_si512(p0, avx512_addmod(u, v, mod->m));
+            v = avx512_submod(u, v, mod->m);
+            _mm512_storeu_si512(p1, avx512_mulmod(v, w, mod));
+        }
+    }
+}
+
+static MPD_AVX512 void
+avx512_dif2(mpd_uint_t a[], mpd_size_t n, const struct fnt_params *tparams)
+{
+    struct avx512_mod mod;
+    struct avx2_mod mod2;
+    mpd_size_t m, wstep;
+
+    avx512_setmod(&mod, tparams->modnum);
+
+    for (m = n, wstep = 1; m >= 16; m >>= 1, wstep <<= 1) {
+        avx512_dif2_stage(a, n, m, wstep, tparams->wtable, &mod);
+    }
+
+    avx2_setmod(&mod2, tparams->modnum);
+    for (; m >= 8; m >>= 1, wstep <<= 1) {
+        avx2_dif2_stage(a, n, m, wstep, tparams->wtable, &mod2);
+    }
+
+    if (n >= 8) {
+        avx2_dif2_tail(a, n, tparams->wtable, &mod2);
+    }
+    else {
+        dif2_stages(a, n, m, wstep, tparams->wtable, tparams->modulus);
+    }
+}
+
+static MPD_AVX512 void
+avx512_mulmod_vec(mpd_uint_t *c1, const mpd_uint_t *c2, mpd_size_t n,
+                  int modnum)
+{
+    struct avx512_mod mod;
+    mpd_size_t i;
+
+    avx512_setmod(&mod, modnum);
+
+    for (i = 0; i+8 <= n; i += 8) {
+        __m512i x = _mm512_loadu_si512(c1+i);
+        __m512i y = _mm512_loadu_si512(c2+i);
+        _mm512_storeu_si512(c1+i, avx512_mulmod(x, y, &mod));
+    }
+    for (; i < n; i++) {
+        c1[i] = x64_mulmod(c1[i], c2[i], mpd_moduli[modnum]);
+    }
+}
+
+static MPD_AVX512 void
+avx512_mulmod_c(mpd_uint_t *c, mpd_uint_t w, mpd_size_t n, int modnum)
+{
+    struct avx512_mod mod;
+    __m512i y;
+    mpd_size_t i;
+
+    avx512_setmod(&mod, modnum);
+    y = _mm512_set1_epi64((long long)w);
+
+    for (i = 0; i+8 <= n; i += 8) {
+        __m512i x = _mm512_loadu_si512(c+i);
+        _mm512_storeu_si512(c+i, avx512_mulmod(x, y, &mod));
+    }
+    for (; i < n; i++) {
+        c[i] = x64_mulmod(c[i], w, mpd_moduli[modnum]);
+    }
+}
+
+
+/******************************************************************************/
+/*                                  Dispatch                                  */
+/******************************************************************************/
+
+struct mpd_simd_kernels _mpd_simd = {NULL, NULL, NULL};
+
+static void __attribute__((constructor))
+_mpd_simd_init(void)
+{
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512f")) {
+        _mpd_simd.dif2 = avx512_dif2;
+        _mpd_simd.mulmod = avx512_mulmod_vec;
+        _mpd_simd.mulmod_c = avx512_mulmod_c;
+    }
+    else if (__builtin_cpu_supports("avx2")) {
+        _mpd_simd.dif2 = avx2_dif2;
+        _mpd_simd.mulmod = avx2_mulmod_vec;
+        _mpd_simd.mulmod_c = avx2_mulmod_c;
+    }
+}
+
+
+#endif /* MPD_FNT_SIMD */
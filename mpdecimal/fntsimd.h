@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2026 Iain Buclaw.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+
+
+#ifndef LIBMPDEC_FNTSIMD_H_
+#define LIBMPDEC_FNTSIMD_H_
+
+
+#include "mpdecimal.h"
+#include "numbertheory.h"
+
+
+/*
+ * Vectorized kernels for the number theoretic transform. They are built
+ * for x86-64 GCC/Clang builds with ASM enabled and are selected at load
+ * time according to the CPU features. If _mpd_simd.dif2 is NULL, the
+ * portable code is used.
+ */
+#if defined(CONFIG_64) && defined(ASM) && defined(__x86_64__) && \
+    (defined(__GNUC__) || defined(__clang__)) && !defined(__IMPORTC__)
+  #define MPD_FNT_SIMD
+#endif
+
+
+#ifdef MPD_FNT_SIMD
+
+/* Internal header file: all symbols have local scope in the DSO */
+MPD_PRAGMA(MPD_HIDE_SYMBOLS_START)
+
+
+struct mpd_simd_kernels {
+    /* All butterflies of fnt_dif2(), without the final permutation. */
+    void (*dif2)(mpd_uint_t a[], mpd_size_t n, const struct fnt_params *tparams);
+    /* c1[i] = c1[i] * c2[i] mod p */
+    void (*mulmod)(mpd_uint_t *c1, const mpd_uint_t *c2, mpd_size_t n, int modnum);
+    /* c[i] = c[i] * w mod p */
+    void (*mulmod_c)(mpd_uint_t *c, mpd_uint_t w, mpd_size_t n, int modnum);
+};
+
+extern struct mpd_simd_kernels _mpd_simd;
+
+
+MPD_PRAGMA(MPD_HIDE_SYMBOLS_END) /* restore previous scope rules */
+
+#endif /* MPD_FNT_SIMD */
+
+
+#endif /* LIBMPDEC_FNTSIMD_H_ */
@@ -28,8 +28,11 @@
 #include <assert.h>
 
 #include "constants.h"
+#include "fnt.h"
 #include "fourstep.h"
 #include "mpdecimal.h"
+#include "mpthread.h"
+#include "mptune.h"
 #include "numbertheory.h"
 #include "sixstep.h"
 #include "umodarith.h"
@@ -132,42 +135,62 @@ ppro_size3_ntt(mpd_uint_t *x1, mpd_uint_t *x2, mpd_uint_t *x3, mpd_uint_t w3tabl
 #endif
 
 
-/* forward transform, sign = -1; transform length = 3 * 2**n */
-int
-four_step_fnt(mpd_uint_t *a, mpd_size_t n, int modnum)
+/* The column transforms and the twiddle multiplications are independent
+   for each column, so they are distributed over the thread pool. */
+struct cols_args {
+    mpd_uint_t *a;
+    mpd_size_t C;
+    mpd_uint_t *w3table;    /* column transforms */
+    mpd_uint_t kernel;      /* twiddle multiplications */
+    int modnum;
+};
+
+/* Length R transform on the columns [lo, hi). */
+static void
+_size3_cols(void *arg, mpd_size_t lo, mpd_size_t hi)
 {
-    mpd_size_t R = 3; /* number of rows */
-    mpd_size_t C = n / 3; /* number of columns */
-    mpd_uint_t w3table[3];
-    mpd_uint_t kernel, w0, w1, wstep;
-    mpd_uint_t *s, *p0, *p1, *p2;
+    struct cols_args *args = arg;
+    mpd_uint_t *a = args->a;
+    mpd_size_t C = args->C;
+    mpd_uint_t *p0, *p1, *p2;
     mpd_uint_t umod;
 #ifdef PPRO
     double dmod;
     uint32_t dinvmod[3];
 #endif
-    mpd_size_t i, k;
 
+    SETMODULUS(args->modnum);
+    for (p0=a+lo, p1=p0+C, p2=p0+2*C; p0<a+hi; p0++,p1++,p2++) {
 
-    assert(n >= 48);
-    assert(n <= 3*MPD_MAXTRANSFORM_2N);
-
-
-    /* Length R transform on the columns. */
-    SETMODULUS(modnum);
-    _mpd_init_w3table(w3table, -1, modnum);
-    for (p0=a, p1=p0+C, p2=p0+2*C; p0<a+C; p0++,p1++,p2++) {
-
-        SIZE3_NTT(p0, p1, p2, w3table);
+        SIZE3_NTT(p0, p1, p2, args->w3table);
     }
+}
 
-    /* Multiply each matrix element (addressed by i*C+k) by r**(i*k). */
-    kernel = _mpd_getkernel(n, -1, modnum);
+/* Multiply each matrix element (addressed by i*C+k) by r**(i*k) for the
+   column pairs [lo, hi), i.e. for k in [2*lo, 2*hi). */
+static void
+_twiddle_cols(void *arg, mpd_size_t lo, mpd_size_t hi)
+{
+    struct cols_args *args = arg;
+    mpd_uint_t *a = args->a;
+    mpd_size_t C = args->C;
+    mpd_size_t R = 3;
+    mpd_uint_t kernel = args->kernel;
+    mpd_uint_t w0, w1, wstep;
+    mpd_uint_t umod;
+#ifdef PPRO
+    double dmod;
+    uint32_t dinvmod[3];
+#endif
+    mpd_size_t i, k;
+
+    SETMODULUS(args->modnum);
     for (i = 1; i < R; i++) {
-        w0 = 1;                  /* r**(i*0): initial value for k=0 */
-        w1 = POWMOD(kernel, i);  /* r**(i*1): initial value for k=1 */
-        wstep = MULMOD(w1, w1);  /* r**(2*i) */
-        for (k = 0; k < C-1; k += 2) {
+        w1 = POWMOD(kernel, i);     /* r**(i*1) */
+        wstep = MULMOD(w1, w1);     /* r**(2*i) */
+        w0 = POWMOD(wstep, lo);     /* r**(i*k): initial value for k=2*lo */
+        w1 = MULMOD(w0, w1);        /* r**(i*(k+1)) */
+        for (k = 2*lo; k < 2*hi; k += 2) {
             mpd_uint_t x0 = a[i*C+k];
             mpd_uint_t x1 = a[i*C+k+1];
             MULMOD2(&x0, w0, &x1, w1);
@@ -176,10 +199,41 @@ four_step_fnt(mpd_uint_t *a, mpd_size_t n, int modnum)
             a[i*C+k+1] = x1;
         }
     }
+}
+
+
+/* forward transform, sign = -1; transform length = 3 * 2**n */
+int
+four_step_fnt(mpd_uint_t *a, mpd_size_t n, int modnum)
+{
+    mpd_size_t R = 3; /* number of rows */
+    mpd_size_t C = n / 3; /* number of columns */
+    mpd_uint_t w3table[3];
+    struct cols_args args;
+    int (*fnt)(mpd_uint_t *, mpd_size_t, int);
+    mpd_uint_t *s;
+
+
+    assert(n >= 48);
+    assert(n <= 3*MPD_MAXTRANSFORM_2N);
+
+    args.a = a;
+    args.C = C;
+    args.w3table = w3table;
+    args.modnum = modnum;
+
+    /* Length R transform on the columns. */
+    _mpd_init_w3table(w3table, -1, modnum);
+    _mpd_parallel_for(C, R, _size3_cols, &args);
+
+    /* Multiply each matrix element (addressed by i*C+k) by r**(i*k). */
+    args.kernel = _mpd_getkernel(n, -1, modnum);
+    _mpd_parallel_for(C/2, 2*(R-1), _twiddle_cols, &args);
 
     /* Length C transform on the rows. */
+    fnt = (C > MPD_SIX_STEP_THRESHOLD) ? six_step_fnt : std_fnt;
     for (s = a; s < a+n; s += C) {
-        if (!six_step_fnt(s, C, modnum)) {
+        if (!fnt(s, C, modnum)) {
             return 0;
         }
     }
@@ -194,49 +248,34 @@ inv_four_step_fnt(mpd_uint_t *a, mpd_size_t n, int modnum)
     mpd_size_t R = 3; /* number of rows */
     mpd_size_t C = n / 3; /* number of columns */
     mpd_uint_t w3table[3];
-    mpd_uint_t kernel, w0, w1, wstep;
-    mpd_uint_t *s, *p0, *p1, *p2;
-    mpd_uint_t umod;
-#ifdef PPRO
-    double dmod;
-    uint32_t dinvmod[3];
-#endif
-    mpd_size_t i, k;
+    struct cols_args args;
+    int (*fnt)(mpd_uint_t *, mpd_size_t, int);
+    mpd_uint_t *s;
 
 
     assert(n >= 48);
     assert(n <= 3*MPD_MAXTRANSFORM_2N);
 
+    args.a = a;
+    args.C = C;
+    args.w3table = w3table;
+    args.modnum = modnum;
+
     /* Length C transform on the rows. */
+    fnt = (C > MPD_SIX_STEP_THRESHOLD) ? inv_six_step_fnt : std_inv_fnt;
     for (s = a; s < a+n; s += C) {
-        if (!inv_six_step_fnt(s, C, modnum)) {
+        if (!fnt(s, C, modnum)) {
             return 0;
         }
     }
 
     /* Multiply each matrix element (addressed by i*C+k) by r**(i*k). */
-    SETMODULUS(modnum);
-    kernel = _mpd_getkernel(n, 1, modnum);
-    for (i = 1; i < R; i++) {
-        w0 = 1;
-        w1 = POWMOD(kernel, i);
-        wstep = MULMOD(w1, w1);
-        for (k = 0; k < C; k += 2) {
-            mpd_uint_t x0 = a[i*C+k];
-            mpd_uint_t x1 = a[i*C+k+1];
-            MULMOD2(&x0, w0, &x1, w1);
-            MULMOD2C(&w0, &w1, wstep);
-            a[i*C+k] = x0;
-            a[i*C+k+1] = x1;
-        }
-    }
+    args.kernel = _mpd_getkernel(n, 1, modnum);
+    _mpd_parallel_for(C/2, 2*(R-1), _twiddle_cols, &args);
 
     /* Length R transform on the columns. */
     _mpd_init_w3table(w3table, 1, modnum);
-    for (p0=a, p1=p0+C, p2=p0+2*C; p0<a+C; p0++,p1++,p2++) {
-
-        SIZE3_NTT(p0, p1, p2, w3table);
-    }
+    _mpd_parallel_for(C, R, _size3_cols, &args);
 
     return 1;
 }
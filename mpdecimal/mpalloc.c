@@ -30,8 +30,10 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "bits.h"
 #include "mpalloc.h"
 #include "mpdecimal.h"
+#include "mpthread.h"
 #include "typearith.h"
 
 
@@ -147,7 +149,9 @@ mpd_sh_alloc(mpd_size_t struct_size, mpd_size_t nmemb, mpd_size_t size)
 
 
 /* Allocate a new decimal with a coefficient of length 'nwords'. In case
-   of an error the return value is NULL. */
+   of an error the return value is NULL. A coefficient of MPD_MINALLOC
+   words is stored behind the struct in the same allocation and flagged
+   as static data, so mpd_del() releases both with one call to mpd_free(). */
 mpd_t *
 mpd_qnew_size(mpd_ssize_t nwords)
 {
@@ -155,6 +159,22 @@ mpd_qnew_size(mpd_ssize_t nwords)
 
     nwords = (nwords < MPD_MINALLOC) ? MPD_MINALLOC : nwords;
 
+    if (nwords == MPD_MINALLOC) {
+        result = mpd_sh_alloc(sizeof *result, nwords, sizeof *result->data);
+        if (result == NULL) {
+            return NULL;
+        }
+
+        result->data = (mpd_uint_t *)(result + 1);
+        result->flags = MPD_STATIC_DATA;
+        result->exp = 0;
+        result->digits = 0;
+        result->len = 0;
+        result->alloc = nwords;
+
+        return result;
+    }
+
     result = mpd_alloc(1, sizeof *result);
     if (result == NULL) {
         return NULL;
@@ -197,21 +217,207 @@ mpd_new(mpd_context_t *ctx)
     return result;
 }
 
+/* Initialize 'x' as the decimal zero with an inline coefficient of
+   MPD_INLINE_WORDS words. Return NULL if MPD_MINALLOC is larger. */
+mpd_t *
+mpd_inline_init(mpd_inline_t *x)
+{
+    mpd_t *result = &x->dec;
+
+    if (MPD_MINALLOC > MPD_INLINE_WORDS) {
+        return NULL;
+    }
+
+    x->words[0] = 0;
+    result->flags = MPD_STATIC|MPD_STATIC_DATA;
+    result->exp = 0;
+    result->digits = 1;
+    result->len = 1;
+    result->alloc = MPD_INLINE_WORDS;
+    result->data = x->words;
+
+    return result;
+}
+
+/******************************************************************************/
+/*                                  Arenas                                    */
+/******************************************************************************/
+
+struct mpd_arena_t {
+    mpd_uint_t *data;
+    mpd_size_t size;    /* capacity in words */
+    mpd_size_t top;     /* words in use */
+};
+
+/* Arena of the calling thread */
+static MPD_THREAD_LOCAL mpd_arena_t *mpd_arena = NULL;
+
+/* Allocate a new arena of 'nwords' words. Return NULL on failure. */
+mpd_arena_t *
+mpd_qnew_arena(mpd_size_t nwords)
+{
+    mpd_arena_t *arena;
+
+    arena = mpd_alloc(1, sizeof *arena);
+    if (arena == NULL) {
+        return NULL;
+    }
+
+    arena->data = mpd_alloc(nwords, sizeof *arena->data);
+    if (arena->data == NULL) {
+        mpd_free(arena);
+        return NULL;
+    }
+
+    arena->size = nwords;
+    arena->top = 0;
+
+    return arena;
+}
+
+/* Free an arena. It must not be installed in any thread. */
+void
+mpd_del_arena(mpd_arena_t *arena)
+{
+    if (mpd_arena == arena) {
+        mpd_arena = NULL;
+    }
+    mpd_free(arena->data);
+    mpd_free(arena);
+}
+
+/* Install 'arena' for the calling thread (NULL: none) and return the
+   previous one. */
+mpd_arena_t *
+mpd_setarena(mpd_arena_t *arena)
+{
+    mpd_arena_t *prev = mpd_arena;
+
+    mpd_arena = arena;
+    return prev;
+}
+
+mpd_arena_t *
+mpd_getarena(void)
+{
+    return mpd_arena;
+}
+
+/* Open a scope. The return value is passed to mpd_arena_pop(). */
+mpd_size_t
+mpd_arena_push(mpd_arena_t *arena)
+{
+    return arena->top;
+}
+
+/* Release everything allocated since the matching mpd_arena_push(). */
+void
+mpd_arena_pop(mpd_arena_t *arena, mpd_size_t scope)
+{
+    assert(scope <= arena->top);
+    arena->top = scope;
+}
+
 /*
- * Input: 'result' is a static mpd_t with a static coefficient.
+ * Scratch array for the duration of a function call. If the thread has an
+ * arena with room, the array is taken from it and 'mark' is set to the
+ * position to return to. Otherwise the array comes from mpd_alloc() and
+ * 'mark' is MPD_SIZE_MAX. Return NULL on failure. No coefficient may be
+ * taken from the arena before the array is released.
+ */
+mpd_uint_t *
+_mpd_scratch_alloc(mpd_size_t nwords, mpd_size_t *mark)
+{
+    mpd_arena_t *arena = mpd_arena;
+
+    if (arena != NULL && arena->size - arena->top >= nwords) {
+        *mark = arena->top;
+        arena->top += nwords;
+        return arena->data + *mark;
+    }
+
+    *mark = MPD_SIZE_MAX;
+    return mpd_alloc(nwords, sizeof(mpd_uint_t));
+}
+
+/* Release a scratch array. Arrays may be released in any order. */
+void
+_mpd_scratch_free(mpd_uint_t *p, mpd_size_t mark)
+{
+    if (mark == MPD_SIZE_MAX) {
+        mpd_free(p);
+    }
+    else if (mark < mpd_arena->top) {
+        mpd_arena->top = mark;
+    }
+}
+
+/*
+ * Input: 'result' is an mpd_t with a static coefficient.
+ * Assumption: 'nwords' >= result->alloc.
+ *
+ * If 'result' is a static mpd_t and an arena is installed and has room,
+ * take a coefficient of 'nwords' from it and return 1. Decimals from
+ * mpd_qnew() never use the arena, since they may outlive the current
+ * scope. The coefficient remains flagged as static, so it
+ * is never freed or reallocated. A coefficient that is the last allocation
+ * of the arena is extended in place. The data is not copied; 'result' is
+ * unchanged if the return value is 0.
+ */
+static int
+_mpd_arena_data(mpd_t *result, mpd_ssize_t nwords)
+{
+    mpd_arena_t *arena = mpd_arena;
+    mpd_size_t alloc = (mpd_size_t)result->alloc;
+    mpd_size_t n = (mpd_size_t)nwords;
+
+    if (arena == NULL || !mpd_isstatic(result)) {
+        return 0;
+    }
+
+    if (arena->top >= alloc &&
+        result->data == arena->data + (arena->top - alloc)) {
+        if (arena->size - arena->top < n - alloc) {
+            return 0;
+        }
+        arena->top += n - alloc;
+    }
+    else {
+        if (arena->size - arena->top < n) {
+            return 0;
+        }
+        result->data = arena->data + arena->top;
+        arena->top += n;
+    }
+
+    result->alloc = nwords;
+    return 1;
+}
+
+/*
+ * Input: 'result' is an mpd_t with a static coefficient.
  * Assumption: 'nwords' >= result->alloc.
  *
  * Resize the static coefficient to a larger dynamic one and copy the
  * existing data. If successful, the value of 'result' is unchanged.
  * Otherwise, set 'result' to NaN and update 'status' with MPD_Malloc_error.
+ * If the thread has an arena, the new coefficient may come from the arena.
  */
 int
 mpd_switch_to_dyn(mpd_t *result, mpd_ssize_t nwords, uint32_t *status)
 {
     mpd_uint_t *p = result->data;
+    mpd_ssize_t alloc = result->alloc;
 
     assert(nwords >= result->alloc);
 
+    if (_mpd_arena_data(result, nwords)) {
+        if (result->data != p) {
+            memcpy(result->data, p, alloc * (sizeof *result->data));
+        }
+        return 1;
+    }
+
     result->data = mpd_alloc(nwords, sizeof *result->data);
     if (result->data == NULL) {
         result->data = p;
@@ -229,16 +435,22 @@ mpd_switch_to_dyn(mpd_t *result, mpd_ssize_t nwords, uint32_t *status)
 }
 
 /*
- * Input: 'result' is a static mpd_t with a static coefficient.
+ * Input: 'result' is an mpd_t with a static coefficient.
  *
  * Convert the coefficient to a dynamic one that is initialized to zero. If
  * malloc fails, set 'result' to NaN and update 'status' with MPD_Malloc_error.
+ * If the thread has an arena, the new coefficient may come from the arena.
  */
 int
 mpd_switch_to_dyn_zero(mpd_t *result, mpd_ssize_t nwords, uint32_t *status)
 {
     mpd_uint_t *p = result->data;
 
+    if (_mpd_arena_data(result, nwords)) {
+        mpd_uint_zero(result->data, nwords);
+        return 1;
+    }
+
     result->data = mpd_calloc(nwords, sizeof *result->data);
     if (result->data == NULL) {
         result->data = p;
@@ -290,7 +502,7 @@ mpd_realloc_dyn(mpd_t *result, mpd_ssize_t nwords, uint32_t *status)
 }
 
 /*
- * Input: 'result' is a static mpd_t with a static coefficient.
+ * Input: 'result' is an mpd_t with a static coefficient.
  * Assumption: 'nwords' >= result->alloc.
  *
  * Resize the static coefficient to a larger dynamic one and copy the
@@ -303,6 +515,15 @@ mpd_switch_to_dyn_cxx(mpd_t *result, mpd_ssize_t nwords)
 {
     assert(nwords >= result->alloc);
 
+    mpd_uint_t *p = result->data;
+    mpd_ssize_t alloc = result->alloc;
+    if (_mpd_arena_data(result, nwords)) {
+        if (result->data != p) {
+            memcpy(result->data, p, alloc * (sizeof *result->data));
+        }
+        return 1;
+    }
+
     mpd_uint_t *data = mpd_alloc(nwords, sizeof *result->data);
     if (data == NULL) {
         return 0;
@@ -345,3 +566,312 @@ mpd_realloc_dyn_cxx(mpd_t *result, mpd_ssize_t nwords)
 
     return 1;
 }
+
+
+/******************************************************************************/
+/*                               Pool allocator                               */
+/******************************************************************************/
+
+/*
+ * Blocks of up to 2**(MPD_POOL_MINSHIFT+MPD_POOL_NCLASSES-1) bytes are
+ * served from power-of-two size classes. Every block has a header with
+ * its class in front of the payload. Larger blocks are passed on to the
+ * functions that were installed before the pool and are tagged with
+ * MPD_POOL_LARGE.
+ *
+ * Each thread caches up to MPD_POOL_MAGSIZE free blocks per class. An empty
+ * cache is refilled with a magazine from the global depot or with a new
+ * slab, and half of a full cache is moved to the depot as a magazine.
+ * Blocks freed by another thread simply join that thread's cache. A
+ * magazine is a chain of free blocks linked through the first payload
+ * word; the depot links magazines through the second payload word of
+ * their first block.
+ */
+#define MPD_POOL_HDR 16          /* header size, keeps the malloc alignment */
+#define MPD_POOL_MINSHIFT 4
+#define MPD_POOL_NCLASSES 9
+#define MPD_POOL_LARGE MPD_POOL_NCLASSES
+#define MPD_POOL_MAGSIZE 32
+
+struct mpd_pool_cache {
+    int n[MPD_POOL_NCLASSES];
+    void *blocks[MPD_POOL_NCLASSES][MPD_POOL_MAGSIZE];
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t large;
+};
+
+static MPD_THREAD_LOCAL struct mpd_pool_cache pool_cache;
+
+static mpd_mutex_t pool_lock = MPD_MUTEX_INITIALIZER;
+static void *pool_depot[MPD_POOL_NCLASSES];
+static mpd_pool_stats_t pool_stats;
+
+/* Memory functions installed before the pool */
+static void *(* pool_sysmalloc)(size_t size) = malloc;
+static void *(* pool_sysrealloc)(void *ptr, size_t size) = realloc;
+static void (* pool_sysfree)(void *ptr) = free;
+
+#define POOL_HEADER(p) ((size_t *)((char *)(p) - MPD_POOL_HDR))
+#define POOL_NEXT(p) (((void **)(p))[0])
+#define POOL_NEXTMAG(p) (((void **)(p))[1])
+
+static inline size_t
+_mpd_pool_class(size_t size)
+{
+    size_t cls;
+
+    if (size <= ((size_t)1 << MPD_POOL_MINSHIFT)) {
+        return 0;
+    }
+    cls = (size_t)mpd_bsr((mpd_size_t)(size-1)) + 1 - MPD_POOL_MINSHIFT;
+    return (cls < MPD_POOL_NCLASSES) ? cls : MPD_POOL_LARGE;
+}
+
+/* Move the thread's counters to the global statistics. Requires pool_lock. */
+static void
+_mpd_pool_fold(struct mpd_pool_cache *c)
+{
+    pool_stats.allocs += c->allocs;
+    pool_stats.frees += c->frees;
+    pool_stats.large += c->large;
+    c->allocs = c->frees = c->large = 0;
+}
+
+/* Refill the empty cache of class 'cls'. Return 0 on failure. */
+static int
+_mpd_pool_refill(struct mpd_pool_cache *c, size_t cls)
+{
+    size_t bsize = ((size_t)1 << (cls+MPD_POOL_MINSHIFT)) + MPD_POOL_HDR;
+    char *slab;
+    void *p;
+    int i;
+
+    mpd_mutex_lock(&pool_lock);
+    p = pool_depot[cls];
+    if (p != NULL) {
+        pool_depot[cls] = POOL_NEXTMAG(p);
+        pool_stats.depot_gets++;
+    }
+    _mpd_pool_fold(c);
+    mpd_mutex_unlock(&pool_lock);
+
+    if (p != NULL) {
+        for (i = 0; p != NULL; i++) {
+            c->blocks[cls][i] = p;
+            p = POOL_NEXT(p);
+        }
+        c->n[cls] = i;
+        return 1;
+    }
+
+    slab = pool_sysmalloc(MPD_POOL_MAGSIZE * bsize);
+    if (slab == NULL) {
+        return 0;
+    }
+    for (i = 0; i < MPD_POOL_MAGSIZE; i++) {
+        *(size_t *)slab = cls;
+        c->blocks[cls][i] = slab + MPD_POOL_HDR;
+        slab += bsize;
+    }
+    c->n[cls] = MPD_POOL_MAGSIZE;
+
+    mpd_mutex_lock(&pool_lock);
+    pool_stats.slab_bytes += MPD_POOL_MAGSIZE * bsize;
+    mpd_mutex_unlock(&pool_lock);
+
+    return 1;
+}
+
+/*
+ * Move the 'n' oldest cached blocks of class 'cls' to the depot as one
+ * magazine. Keeping the newer half of a full cache avoids a depot round
+ * trip for every alloc/free pair at the boundary.
+ */
+static void
+_mpd_pool_spill(struct mpd_pool_cache *c, size_t cls, int n)
+{
+    void **blocks = c->blocks[cls];
+    int i;
+
+    if (n == 0) {
+        return;
+    }
+
+    for (i = 0; i < n-1; i++) {
+        POOL_NEXT(blocks[i]) = blocks[i+1];
+    }
+    POOL_NEXT(blocks[n-1]) = NULL;
+
+    mpd_mutex_lock(&pool_lock);
+    POOL_NEXTMAG(blocks[0]) = pool_depot[cls];
+    pool_depot[cls] = blocks[0];
+    pool_stats.depot_puts++;
+    _mpd_pool_fold(c);
+    mpd_mutex_unlock(&pool_lock);
+
+    c->n[cls] -= n;
+    memmove(blocks, blocks+n, c->n[cls] * sizeof *blocks);
+}
+
+static void *
+_mpd_pool_malloc(size_t size)
+{
+    struct mpd_pool_cache *c = &pool_cache;
+    size_t cls = _mpd_pool_class(size);
+    char *p;
+
+    if (cls == MPD_POOL_LARGE) {
+        if (size > SIZE_MAX - MPD_POOL_HDR) {
+            return NULL;
+        }
+        p = pool_sysmalloc(size + MPD_POOL_HDR);
+        if (p == NULL) {
+            return NULL;
+        }
+        *(size_t *)p = MPD_POOL_LARGE;
+        c->large++;
+        return p + MPD_POOL_HDR;
+    }
+
+    if (c->n[cls] == 0 && !_mpd_pool_refill(c, cls)) {
+        return NULL;
+    }
+    c->allocs++;
+    return c->blocks[cls][--c->n[cls]];
+}
+
+static void
+_mpd_pool_free(void *ptr)
+{
+    struct mpd_pool_cache *c = &pool_cache;
+    size_t cls;
+
+    if (ptr == NULL) {
+        return;
+    }
+
+    cls = *POOL_HEADER(ptr);
+    if (cls == MPD_POOL_LARGE) {
+        pool_sysfree(POOL_HEADER(ptr));
+        return;
+    }
+
+    if (c->n[cls] == MPD_POOL_MAGSIZE) {
+        _mpd_pool_spill(c, cls, MPD_POOL_MAGSIZE/2);
+    }
+    c->frees++;
+    c->blocks[cls][c->n[cls]++] = ptr;
+}
+
+static void *
+_mpd_pool_calloc(size_t nmemb, size_t size)
+{
+    void *ptr;
+    size_t req;
+    mpd_size_t overflow;
+
+    req = mul_size_t_overflow((mpd_size_t)nmemb, (mpd_size_t)size,
+                              &overflow);
+    if (overflow) {
+        return NULL;
+    }
+
+    ptr = _mpd_pool_malloc(req);
+    if (ptr == NULL) {
+        return NULL;
+    }
+    memset(ptr, 0, req);
+
+    return ptr;
+}
+
+static void *
+_mpd_pool_realloc(void *ptr, size_t size)
+{
+    size_t cls, newcls, n;
+    char *p;
+
+    if (ptr == NULL) {
+        return _mpd_pool_malloc(size);
+    }
+
+    cls = *POOL_HEADER(ptr);
+    newcls = _mpd_pool_class(size);
+    if (cls == MPD_POOL_LARGE && newcls == MPD_POOL_LARGE) {
+        if (size > SIZE_MAX - MPD_POOL_HDR) {
+            return NULL;
+        }
+        p = pool_sysrealloc(POOL_HEADER(ptr), size + MPD_POOL_HDR);
+        return (p == NULL) ? NULL : p + MPD_POOL_HDR;
+    }
+    if (newcls <= cls && cls != MPD_POOL_LARGE) {
+        return ptr;
+    }
+
+    p = _mpd_pool_malloc(size);
+    if (p == NULL) {
+        return NULL;
+    }
+    /* a large block is always longer than 'size' here */
+    n = (cls == MPD_POOL_LARGE) ? size : (size_t)1 << (cls+MPD_POOL_MINSHIFT);
+    memcpy(p, ptr, n);
+    _mpd_pool_free(ptr);
+
+    return p;
+}
+
+/*
+ * Install the pool allocator. The previous memory functions are used for
+ * the slabs and for large blocks.
+ */
+void
+mpd_pool_install(void)
+{
+    if (mpd_mallocfunc == _mpd_pool_malloc) {
+        return;
+    }
+
+    pool_sysmalloc = mpd_mallocfunc;
+    pool_sysrealloc = mpd_reallocfunc;
+    pool_sysfree = mpd_free;
+
+    mpd_mallocfunc = _mpd_pool_malloc;
+    mpd_callocfunc = _mpd_pool_calloc;
+    mpd_reallocfunc = _mpd_pool_realloc;
+    mpd_free = _mpd_pool_free;
+}
+
+/* Move the cached blocks of the calling thread to the depot. */
+void
+mpd_pool_flush(void)
+{
+    struct mpd_pool_cache *c = &pool_cache;
+    size_t cls;
+
+    for (cls = 0; cls < MPD_POOL_NCLASSES; cls++) {
+        _mpd_pool_spill(c, cls, c->n[cls]);
+    }
+
+    mpd_mutex_lock(&pool_lock);
+    _mpd_pool_fold(c);
+    mpd_mutex_unlock(&pool_lock);
+}
+
+/*
+ * Statistics of the pool. Counts of other threads are included up to
+ * their last exchange with the depot.
+ */
+void
+mpd_pool_stats(mpd_pool_stats_t *stats)
+{
+    struct mpd_pool_cache *c = &pool_cache;
+
+    mpd_mutex_lock(&pool_lock);
+    *stats = pool_stats;
+    mpd_mutex_unlock(&pool_lock);
+
+    stats->allocs += c->allocs;
+    stats->frees += c->frees;
+    stats->large += c->large;
+}
@@ -46,6 +46,9 @@ int mpd_realloc_dyn(mpd_t *result, mpd_ssize_t nwords, uint32_t *status);
 int mpd_switch_to_dyn_cxx(mpd_t *result, mpd_ssize_t nwords);
 int mpd_realloc_dyn_cxx(mpd_t *result, mpd_ssize_t nwords);
 
+mpd_uint_t *_mpd_scratch_alloc(mpd_size_t nwords, mpd_size_t *mark);
+void _mpd_scratch_free(mpd_uint_t *p, mpd_size_t mark);
+
 
 MPD_PRAGMA(MPD_HIDE_SYMBOLS_END) /* restore previous scope rules */
 
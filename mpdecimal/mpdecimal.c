@@ -37,8 +37,11 @@
 #include "constants.h"
 #include "convolute.h"
 #include "crt.h"
+#include "fntsimd.h"
 #include "mpalloc.h"
 #include "mpdecimal.h"
+#include "mpthread.h"
+#include "mptune.h"
 #include "typearith.h"
 
 
@@ -76,8 +79,6 @@
 #endif
 
 
-#define MPD_NEWTONDIV_CUTOFF 1024L
-
 #define MPD_NEW_STATIC(name, flags, exp, digits, len) \
         mpd_uint_t name##_data[MPD_MINALLOC_MAX];                    \
         mpd_t name = {flags|MPD_STATIC|MPD_STATIC_DATA, exp, digits, \
@@ -113,10 +114,23 @@ static void _mpd_qadd(mpd_t *result, const mpd_t *a, const mpd_t *b,
 static inline void _mpd_qmul(mpd_t *result, const mpd_t *a, const mpd_t *b,
                              const mpd_context_t *ctx, uint32_t *status);
 static void _mpd_base_ndivmod(mpd_t *q, mpd_t *r, const mpd_t *a,
-                              const mpd_t *b, uint32_t *status);
+                              const mpd_t *b, const mpd_divisor_t *dv,
+                              uint32_t *status);
+static int _mpd_base_bzdivmod(mpd_uint_t *q, mpd_uint_t *r,
+                              const mpd_uint_t *uconst,
+                              const mpd_uint_t *vconst,
+                              mpd_size_t nplusm, mpd_size_t n);
+static int _mpd_base_divmod_norm(mpd_uint_t *q, mpd_uint_t *r,
+                                 const mpd_uint_t *uconst,
+                                 const mpd_uint_t *v, mpd_uint_t d,
+                                 mpd_size_t nplusm, mpd_size_t n);
+static void _mpd_qreciprocal(mpd_t *result, const mpd_t *a,
+                             const mpd_context_t *ctx, uint32_t *status);
 static inline void _mpd_qpow_uint(mpd_t *result, const mpd_t *base,
                                   mpd_uint_t exp, uint8_t resultsign,
                                   const mpd_context_t *ctx, uint32_t *status);
+static void _mpd_qinvroot(mpd_t *result, const mpd_t *a,
+                          const mpd_context_t *ctx, uint32_t *status);
 
 static mpd_uint_t mpd_qsshiftr(mpd_t *result, const mpd_t *a, mpd_ssize_t n);
 
@@ -3749,11 +3763,38 @@ _mpd_qdiv_inf(mpd_t *result, const mpd_t *a, const mpd_t *b,
     *status |= MPD_Clamped;
 }
 
+/* Divisor with precomputed data for repeated divisions. */
+struct mpd_divisor_t {
+    mpd_t *v;                /* copy of the divisor */
+    mpd_uint_t *vn;          /* coefficient times d (len+1 words), or NULL */
+    mpd_uint_t d;            /* normalization factor for _mpd_basedivmod() */
+    struct word_inverse inv; /* inverse of a single word coefficient */
+    mpd_t *x;                /* reciprocal of the coefficient, or NULL */
+    mpd_ssize_t xprec;       /* precision of x */
+};
+
+/*
+ * Return 1 if dv holds a reciprocal that is precise enough for dividing
+ * the coefficient of a by the coefficient of b. _mpd_base_ndivmod() needs
+ * a->digits - b->digits + 4 digits.
+ */
+static inline int
+_mpd_divisor_hasrecip(const mpd_divisor_t *dv, const mpd_t *a,
+                      const mpd_t *b)
+{
+    return dv != NULL && dv->x != NULL &&
+           a->digits - b->digits + 4 <= dv->xprec;
+}
+
 enum {NO_IDEAL_EXP, SET_IDEAL_EXP};
-/* Divide a by b. */
+/*
+ * Divide a by b. If dv is not NULL, it is the prepared divisor for b and
+ * its precomputed data is used for the division of the coefficients.
+ */
 static void
 _mpd_qdiv(int action, mpd_t *q, const mpd_t *a, const mpd_t *b,
-          const mpd_context_t *ctx, uint32_t *status)
+          const mpd_divisor_t *dv, const mpd_context_t *ctx,
+          uint32_t *status)
 {
     MPD_NEW_STATIC(aligned,0,0,0,0);
     mpd_uint_t ld;
@@ -3806,6 +3847,7 @@ _mpd_qdiv(int action, mpd_t *q, const mpd_t *a, const mpd_t *b,
             goto finish;
         }
         b = &aligned;
+        dv = NULL;
     }
 
 
@@ -3819,11 +3861,33 @@ _mpd_qdiv(int action, mpd_t *q, const mpd_t *a, const mpd_t *b,
 
 
     if (b->len == 1) {
-        rem = _mpd_shortdiv(q->data, a->data, a->len, b->data[0]);
+        if (dv != NULL) {
+            rem = _mpd_shortdiv_inv(q->data, a->data, a->len, &dv->inv);
+        }
+        else {
+            rem = _mpd_shortdiv(q->data, a->data, a->len, b->data[0]);
+        }
+    }
+    else if (dv != NULL && dv->vn != NULL) {
+        int ret = _mpd_base_divmod_norm(q->data, NULL, a->data, dv->vn, dv->d,
+                                        a->len, b->len);
+        if (ret < 0) {
+            mpd_seterror(q, MPD_Malloc_error, status);
+            goto finish;
+        }
+        rem = ret;
     }
-    else if (b->len <= MPD_NEWTONDIV_CUTOFF) {
-        int ret = _mpd_basedivmod(q->data, NULL, a->data, b->data,
+    else if (b->len <= MPD_NEWTONDIV_CUTOFF &&
+             !_mpd_divisor_hasrecip(dv, a, b)) {
+        int ret;
+        if (b->len <= MPD_BZDIV_CUTOFF) {
+            ret = _mpd_basedivmod(q->data, NULL, a->data, b->data,
                                   a->len, b->len);
+        }
+        else {
+            ret = _mpd_base_bzdivmod(q->data, NULL, a->data, b->data,
+                                     a->len, b->len);
+        }
         if (ret < 0) {
             mpd_seterror(q, MPD_Malloc_error, status);
             goto finish;
@@ -3832,7 +3896,7 @@ _mpd_qdiv(int action, mpd_t *q, const mpd_t *a, const mpd_t *b,
     }
     else {
         MPD_NEW_STATIC(r,0,0,0,0);
-        _mpd_base_ndivmod(q, &r, a, b, status);
+        _mpd_base_ndivmod(q, &r, a, b, dv, status);
         if (mpd_isspecial(q) || mpd_isspecial(&r)) {
             mpd_setspecial(q, MPD_POS, MPD_NAN);
             mpd_del(&r);
@@ -3872,10 +3936,15 @@ finish:
     mpd_qfinalize(q, ctx, status);
 }
 
-/* Divide a by b. */
-void
-mpd_qdiv(mpd_t *q, const mpd_t *a, const mpd_t *b,
-         const mpd_context_t *ctx, uint32_t *status)
+/*
+ * Divide a by b, with an optional prepared divisor dv for b. Quotients that
+ * fail at the context precision are retried at a lower precision in case
+ * the result is exact.
+ */
+static void
+_mpd_qdiv_retry(mpd_t *q, const mpd_t *a, const mpd_t *b,
+                const mpd_divisor_t *dv, const mpd_context_t *ctx,
+                uint32_t *status)
 {
     MPD_NEW_STATIC(aa,0,0,0,0);
     MPD_NEW_STATIC(bb,0,0,0,0);
@@ -3897,7 +3966,7 @@ mpd_qdiv(mpd_t *q, const mpd_t *a, const mpd_t *b,
         b = &bb;
     }
 
-    _mpd_qdiv(SET_IDEAL_EXP, q, a, b, ctx, &xstatus);
+    _mpd_qdiv(SET_IDEAL_EXP, q, a, b, dv, ctx, &xstatus);
 
     if (xstatus & (MPD_Malloc_error|MPD_Division_impossible)) {
         /* Inexact quotients (the usual case) fill the entire context precision,
@@ -3930,7 +3999,7 @@ mpd_qdiv(mpd_t *q, const mpd_t *a, const mpd_t *b,
             goto out;  /* No point in retrying, keep the original error. */
         }
 
-        _mpd_qdiv(SET_IDEAL_EXP, q, a, b, &workctx, &ystatus);
+        _mpd_qdiv(SET_IDEAL_EXP, q, a, b, dv, &workctx, &ystatus);
         if (ystatus != 0) {
             ystatus = *status | ((ystatus|xstatus)&MPD_Errors);
             mpd_seterror(q, ystatus, status);
@@ -3946,10 +4015,19 @@ out:
     mpd_del(&bb);
 }
 
-/* Internal function. */
+/* Divide a by b. */
+void
+mpd_qdiv(mpd_t *q, const mpd_t *a, const mpd_t *b,
+         const mpd_context_t *ctx, uint32_t *status)
+{
+    _mpd_qdiv_retry(q, a, b, NULL, ctx, status);
+}
+
+/* Internal function. If dv is not NULL, it is the prepared divisor for b. */
 static void
 _mpd_qdivmod(mpd_t *q, mpd_t *r, const mpd_t *a, const mpd_t *b,
-             const mpd_context_t *ctx, uint32_t *status)
+             const mpd_divisor_t *dv, const mpd_context_t *ctx,
+             uint32_t *status)
 {
     MPD_NEW_STATIC(aligned,0,0,0,0);
     mpd_ssize_t qsize, rsize;
@@ -4014,6 +4092,7 @@ _mpd_qdivmod(mpd_t *q, mpd_t *r, const mpd_t *a, const mpd_t *b,
                 goto nanresult;
             }
             b = &aligned;
+            dv = NULL;
         }
     }
 
@@ -4037,21 +4116,39 @@ _mpd_qdivmod(mpd_t *q, mpd_t *r, const mpd_t *a, const mpd_t *b,
         if (a->len == 1) {
             _mpd_div_word(&q->data[0], &r->data[0], a->data[0], b->data[0]);
         }
+        else if (dv != NULL) {
+            r->data[0] = _mpd_shortdiv_inv(q->data, a->data, a->len,
+                                           &dv->inv);
+        }
         else {
             r->data[0] = _mpd_shortdiv(q->data, a->data, a->len, b->data[0]);
         }
     }
-    else if (b->len <= MPD_NEWTONDIV_CUTOFF) {
+    else if (dv != NULL && dv->vn != NULL) {
+        if (_mpd_base_divmod_norm(q->data, r->data, a->data, dv->vn, dv->d,
+                                  a->len, b->len) < 0) {
+            *status |= MPD_Malloc_error;
+            goto nanresult;
+        }
+    }
+    else if (b->len <= MPD_NEWTONDIV_CUTOFF &&
+             !_mpd_divisor_hasrecip(dv, a, b)) {
         int ret;
-        ret = _mpd_basedivmod(q->data, r->data, a->data, b->data,
-                              a->len, b->len);
+        if (b->len <= MPD_BZDIV_CUTOFF) {
+            ret = _mpd_basedivmod(q->data, r->data, a->data, b->data,
+                                  a->len, b->len);
+        }
+        else {
+            ret = _mpd_base_bzdivmod(q->data, r->data, a->data, b->data,
+                                     a->len, b->len);
+        }
         if (ret == -1) {
             *status |= MPD_Malloc_error;
             goto nanresult;
         }
     }
     else {
-        _mpd_base_ndivmod(q, r, a, b, status);
+        _mpd_base_ndivmod(q, r, a, b, dv, status);
         if (mpd_isspecial(q) || mpd_isspecial(r)) {
             goto nanresult;
         }
@@ -4138,7 +4235,7 @@ mpd_qdivmod(mpd_t *q, mpd_t *r, const mpd_t *a, const mpd_t *b,
         return;
     }
 
-    _mpd_qdivmod(q, r, a, b, ctx, status);
+    _mpd_qdivmod(q, r, a, b, NULL, ctx, status);
     mpd_qfinalize(q, ctx, status);
     mpd_qfinalize(r, ctx, status);
 }
@@ -4181,11 +4278,146 @@ mpd_qdivint(mpd_t *q, const mpd_t *a, const mpd_t *b,
     }
 
 
-    _mpd_qdivmod(q, &r, a, b, ctx, status);
+    _mpd_qdivmod(q, &r, a, b, NULL, ctx, status);
     mpd_del(&r);
     mpd_qfinalize(q, ctx, status);
 }
 
+/*
+ * Prepare b for repeated divisions with a context precision of up to
+ * 'maxprec'. Depending on the length of the coefficient, the divisor holds
+ * the inverse of a single word, the coefficient normalized for long and
+ * recursive division, or a reciprocal that is accurate enough for quotients
+ * of maxprec digits. If b is special or zero, the divisor only keeps a copy
+ * of b.
+ *
+ * Returns NULL and sets MPD_Malloc_error in case of failure.
+ */
+mpd_divisor_t *
+mpd_qnew_divisor(const mpd_t *b, mpd_ssize_t maxprec, uint32_t *status)
+{
+    mpd_divisor_t *dv;
+    mpd_context_t workctx;
+    mpd_t bb;
+    mpd_size_t n;
+
+    dv = mpd_alloc(1, sizeof *dv);
+    if (dv == NULL) {
+        *status |= MPD_Malloc_error;
+        return NULL;
+    }
+    dv->vn = NULL;
+    dv->d = 0;
+    dv->x = NULL;
+    dv->xprec = 0;
+
+    if ((dv->v = mpd_qncopy(b)) == NULL) {
+        mpd_free(dv);
+        *status |= MPD_Malloc_error;
+        return NULL;
+    }
+
+    if (mpd_isspecial(b) || mpd_iszerocoeff(b)) {
+        return dv;
+    }
+
+    n = b->len;
+    if (n == 1) {
+        _mpd_init_word_inverse(&dv->inv, b->data[0]);
+    }
+    else if (n > MPD_RECIPDIV_CUTOFF && maxprec > 0) {
+        /* For long divisors, a division with the stored reciprocal is
+           faster than recursive division. _mpd_base_ndivmod() needs a
+           reciprocal with a precision of at most prec+5 for quotients with
+           a precision of prec. */
+        _mpd_copy_shared(&bb, b);
+        mpd_set_positive(&bb);
+        bb.exp = 0;
+
+        mpd_maxcontext(&workctx);
+        workctx.prec = (maxprec > MPD_MAX_PREC-5) ? MPD_MAX_PREC : maxprec+5;
+
+        if ((dv->x = mpd_qnew()) == NULL) {
+            goto malloc_error;
+        }
+        _mpd_qreciprocal(dv->x, &bb, &workctx, &workctx.status);
+        if (mpd_isspecial(dv->x)) {
+            goto malloc_error;
+        }
+        dv->xprec = workctx.prec;
+    }
+    else if (n <= (mpd_size_t)MPD_NEWTONDIV_CUTOFF) {
+        if ((dv->vn = mpd_alloc(n+1, sizeof *dv->vn)) == NULL) {
+            goto malloc_error;
+        }
+        dv->d = MPD_RADIX / (b->data[n-1] + 1);
+        _mpd_shortmul(dv->vn, b->data, n, dv->d);
+    }
+
+    return dv;
+
+malloc_error:
+    mpd_del_divisor(dv);
+    *status |= MPD_Malloc_error;
+    return NULL;
+}
+
+void
+mpd_del_divisor(mpd_divisor_t *dv)
+{
+    if (dv->vn) mpd_free(dv->vn);
+    if (dv->x) mpd_del(dv->x);
+    mpd_del(dv->v);
+    mpd_free(dv);
+}
+
+/* Divide a by a prepared divisor. The result is the same as that of
+   mpd_qdiv(). */
+void
+mpd_qdiv_prepared(mpd_t *q, const mpd_t *a, const mpd_divisor_t *dv,
+                  const mpd_context_t *ctx, uint32_t *status)
+{
+    _mpd_qdiv_retry(q, a, dv->v, dv, ctx, status);
+}
+
+/* Integer division with remainder by a prepared divisor. The result is the
+   same as that of mpd_qdivmod(). */
+void
+mpd_qdivmod_prepared(mpd_t *q, mpd_t *r, const mpd_t *a,
+                     const mpd_divisor_t *dv, const mpd_context_t *ctx,
+                     uint32_t *status)
+{
+    const mpd_t *b = dv->v;
+
+    if (mpd_isspecial(a) || mpd_isspecial(b) || mpd_iszerocoeff(b)) {
+        mpd_qdivmod(q, r, a, b, ctx, status);
+        return;
+    }
+
+    _mpd_qdivmod(q, r, a, b, dv, ctx, status);
+    mpd_qfinalize(q, ctx, status);
+    mpd_qfinalize(r, ctx, status);
+}
+
+/* Remainder by a prepared divisor. The result is the same as that of
+   mpd_qrem(). */
+void
+mpd_qrem_prepared(mpd_t *r, const mpd_t *a, const mpd_divisor_t *dv,
+                  const mpd_context_t *ctx, uint32_t *status)
+{
+    MPD_NEW_STATIC(q,0,0,0,0);
+    const mpd_t *b = dv->v;
+
+    if (mpd_isspecial(a) || mpd_isspecial(b) || mpd_iszerocoeff(b)) {
+        mpd_qrem(r, a, b, ctx, status);
+        return;
+    }
+
+    _mpd_qdivmod(&q, r, a, b, dv, ctx, status);
+    mpd_del(&q);
+    mpd_qfinalize(r, ctx, status);
+}
+
 /* Divide decimal by mpd_ssize_t. */
 void
 mpd_qdiv_ssize(mpd_t *result, const mpd_t *a, mpd_ssize_t b,
@@ -4350,6 +4582,170 @@ _mpd_get_exp_iterations(const mpd_t *r, mpd_ssize_t p)
     return n >= 3 ? n : 3;
 }
 
+/*
+ * Binary splitting for exp(r), abs(r) < 1, at high precision. r is split
+ * into chunks of doubling length (the bit-burst method): for a chunk x
+ * with abs(x) < 10**-s, the series needs about prec/s terms, and in the
+ * splitting the products grow to about prec digits, so that most of the
+ * work is done by transform multiplications. exp(r) is the product of the
+ * sums for the chunks.
+ */
+#define MPD_EXP_BSPLIT_GUARD 10
+
+/*
+ * Set T/Q to the sum of the terms x**k/k! for a <= k < b, relative to the
+ * term x**a/a!, and P to x**(b-a). All operations are exact. P is only
+ * needed for ranges that are not at the right end of the series.
+ */
+static void
+_mpd_exp_bsplit(mpd_t *P, mpd_t *Q, mpd_t *T, const mpd_t *x,
+                mpd_ssize_t a, mpd_ssize_t b, int needp,
+                const mpd_context_t *maxctx, uint32_t *status)
+{
+    MPD_NEW_STATIC(Pr,0,0,0,0);
+    MPD_NEW_STATIC(Qr,0,0,0,0);
+    MPD_NEW_STATIC(Tr,0,0,0,0);
+    mpd_ssize_t m;
+
+    if (b - a == 1) {
+        if (a == 0) {
+            _settriple(P, MPD_POS, 1, 0);
+            _settriple(Q, MPD_POS, 1, 0);
+            _settriple(T, MPD_POS, 1, 0);
+        }
+        else {
+            mpd_qcopy(P, x, status);
+            mpd_qset_ssize(Q, a, maxctx, status);
+            mpd_qcopy(T, x, status);
+        }
+        return;
+    }
+
+    m = a + (b-a) / 2;
+    _mpd_exp_bsplit(P, Q, T, x, a, m, 1, maxctx, status);
+    _mpd_exp_bsplit(&Pr, &Qr, &Tr, x, m, b, needp, maxctx, status);
+
+    /* T = T*Qr + P*Tr */
+    mpd_qmul(T, T, &Qr, maxctx, status);
+    mpd_qmul(&Tr, P, &Tr, maxctx, status);
+    mpd_qadd(T, T, &Tr, maxctx, status);
+    mpd_qmul(Q, Q, &Qr, maxctx, status);
+    if (needp) {
+        mpd_qmul(P, P, &Pr, maxctx, status);
+    }
+
+    mpd_del(&Pr);
+    mpd_del(&Qr);
+    mpd_del(&Tr);
+}
+
+/*
+ * Number of terms of the series for abs(x) < 10**-s, such that the
+ * remainder is less than 10**-prec. The remainder after n terms is less
+ * than twice the term x**n/n!, which is less than 10**(-prec-1).
+ */
+static mpd_ssize_t
+_mpd_exp_bsplit_terms(mpd_ssize_t s, mpd_ssize_t prec)
+{
+    double lg = 0.0; /* upper bound for log10(abs(x)**n/n!) */
+    mpd_ssize_t n;
+
+    for (n = 1; ; n++) {
+        lg -= (double)s + log10((double)n);
+        if (lg < -(double)prec - 1.0) {
+            return n;
+        }
+    }
+}
+
+/*
+ * Set 'result' to exp(r), abs(r) < 1, rounded to workctx->prec digits.
+ * All chunks, sums and products are computed with MPD_EXP_BSPLIT_GUARD
+ * extra digits, so that apart from the final rounding the relative error
+ * is less than 10**(-workctx->prec-5). This is below the error bound of
+ * the last step of the Horner scheme in _mpd_qexp().
+ */
+static void
+_mpd_qexp_bsplit(mpd_t *result, const mpd_t *r, const mpd_context_t *workctx,
+                 uint32_t *status)
+{
+    mpd_context_t maxctx, varctx;
+    MPD_NEW_STATIC(rest,0,0,0,0);
+    MPD_NEW_STATIC(x,0,0,0,0);
+    MPD_NEW_STATIC(P,0,0,0,0);
+    MPD_NEW_STATIC(Q,0,0,0,0);
+    MPD_NEW_STATIC(T,0,0,0,0);
+    mpd_ssize_t f, s, len, shift, n;
+
+    assert(!mpd_iszero(r) && r->exp < 0);
+
+    mpd_maxcontext(&maxctx);
+    mpd_maxcontext(&varctx);
+    varctx.prec = workctx->prec + MPD_EXP_BSPLIT_GUARD;
+
+    /* rest := abs(r) * 10**f as an integer, truncated to f <= prec digits */
+    f = -r->exp;
+    shift = 0;
+    if (f > varctx.prec) {
+        shift = f - varctx.prec;
+        f = varctx.prec;
+    }
+    if (mpd_qshiftr(&rest, r, shift, status) == MPD_UINT_MAX) {
+        goto malloc_error;
+    }
+    rest.exp = 0;
+    mpd_set_positive(&rest);
+
+    _settriple(result, MPD_POS, 1, 0);
+
+    /* The chunk x holds the fractional digits s+1 ... s+len of r. */
+    for (s = 0, len = 1; s < f; s += len, len = s) {
+        if (mpd_iszerocoeff(&rest)) {
+            break;
+        }
+        if (len > f - s) {
+            len = f - s;
+        }
+        shift = f - (s+len);
+
+        if (mpd_qshiftr(&x, &rest, shift, status) == MPD_UINT_MAX) {
+            goto malloc_error;
+        }
+        if (mpd_iszerocoeff(&x)) {
+            continue;
+        }
+        if (!mpd_qshiftl(&T, &x, shift, status)) {
+            goto malloc_error;
+        }
+        mpd_qsub(&rest, &rest, &T, &maxctx, status);
+        x.exp = -(s+len);
+        mpd_set_sign(&x, mpd_sign(r));
+
+        n = _mpd_exp_bsplit_terms(s, varctx.prec);
+        _mpd_exp_bsplit(&P, &Q, &T, &x, 0, n, 0, &maxctx, status);
+        mpd_qdiv(&T, &T, &Q, &varctx, status);
+        mpd_qmul(result, result, &T, &varctx, status);
+        if (mpd_isspecial(result) || mpd_isspecial(&rest)) {
+            goto malloc_error;
+        }
+    }
+
+    mpd_qfinalize(result, workctx, status);
+
+
+out:
+    mpd_del(&rest);
+    mpd_del(&x);
+    mpd_del(&P);
+    mpd_del(&Q);
+    mpd_del(&T);
+    return;
+
+malloc_error:
+    mpd_seterror(result, MPD_Malloc_error, status);
+    goto out;
+}
+
 /*
  * Internal function, specials have been dealt with. Apart from Overflow
  * and Underflow, two cases must be considered for the error of the result:
@@ -4452,19 +4848,29 @@ _mpd_qexp(mpd_t *result, const mpd_t *a, const mpd_context_t *ctx,
      *    3) log10(9) - prec - t - 1 < log10(abs(r)) < adjexp(abs(r)) + 1
      *    4) - prec - t - 2 < adjexp(abs(r)) <= -1
      */
-    n = _mpd_get_exp_iterations(result, workctx.prec);
-    if (n == MPD_SSIZE_MAX) {
-        mpd_seterror(result, MPD_Invalid_operation, status); /* GCOV_UNLIKELY */
-        return 1; /* GCOV_UNLIKELY */
+    if (workctx.prec / MPD_RDIGITS >= MPD_EXP_BSPLIT_CUTOFF) {
+        _mpd_qexp_bsplit(&sum, result, &workctx, &workctx.status);
+        if (mpd_isnan(&sum)) {
+            mpd_seterror(result, MPD_Malloc_error, status);
+            mpd_del(&sum);
+            return 1;
+        }
     }
+    else {
+        n = _mpd_get_exp_iterations(result, workctx.prec);
+        if (n == MPD_SSIZE_MAX) {
+            mpd_seterror(result, MPD_Invalid_operation, status); /* GCOV_UNLIKELY */
+            return 1; /* GCOV_UNLIKELY */
+        }
 
-    _settriple(&sum, MPD_POS, 1, 0);
+        _settriple(&sum, MPD_POS, 1, 0);
 
-    for (j = n-1; j >= 1; j--) {
-        word.data[0] = j;
-        mpd_setdigits(&word);
-        mpd_qdiv(&tmp, result, &word, &workctx, &workctx.status);
-        mpd_qfma(&sum, &sum, &tmp, &one, &workctx, &workctx.status);
+        for (j = n-1; j >= 1; j--) {
+            word.data[0] = j;
+            mpd_setdigits(&word);
+            mpd_qdiv(&tmp, result, &word, &workctx, &workctx.status);
+            mpd_qfma(&sum, &sum, &tmp, &one, &workctx, &workctx.status);
+        }
     }
 
 #ifdef CONFIG_64
@@ -4742,73 +5148,264 @@ static const mpd_t _mpd_ln10 = {
 };
 
 /*
- * Set 'result' to log(10).
- *   Ulp error: abs(result - log(10)) < ulp(log(10))
- *   Relative error: abs(result - log(10)) < 5 * 10**-prec * log(10)
- *
- * NOTE: The relative error is not derived from the ulp error, but
- * calculated separately using the fact that 23/10 < log(10) < 24/10.
+ * Constants that are computed at run time are kept in a process-wide cache
+ * that only grows. A cached value v satisfies abs(v - c) < ulp(v), so if
+ * v - ulp(v) and v + ulp(v) round to the same prec digits, that is the
+ * correctly rounded constant c. Otherwise, the constant is recomputed with
+ * at least a quarter more digits than the cached value. The computation
+ * runs without holding the lock, and a result only replaces the cached
+ * value if it is longer.
  */
-void
-mpd_qln10(mpd_t *result, mpd_ssize_t prec, uint32_t *status)
-{
-    mpd_context_t varcontext, maxcontext;
-    MPD_NEW_STATIC(tmp, 0,0,0,0);
-    MPD_NEW_CONST(static10, 0,0,2,1,1,10);
-    mpd_ssize_t klist[MPD_MAX_PREC_LOG2];
-    mpd_uint_t rnd;
-    mpd_ssize_t shift;
-    int i;
+#define MPD_CONSTCACHE_GUARD 10
 
-    assert(prec >= 1);
+static mpd_mutex_t constcache_lock = MPD_MUTEX_INITIALIZER;
+static mpd_t *ln10cache = NULL;     /* log(10) beyond _mpd_ln10 */
+static mpd_t *pihalfcache = NULL;   /* pi/2 for the AGM logarithm */
+
+/*
+ * Round the cached value in 'slot' to prec digits. Return 1 if 'result'
+ * is set (or an error occurred), 0 otherwise. 'cdigits' is set to the
+ * number of digits of the cached value and 'init' to a copy of it if it
+ * is too short.
+ */
+static int
+_mpd_constcache_get(mpd_t *result, mpd_t **slot, mpd_t *init,
+                    mpd_ssize_t *cdigits, mpd_ssize_t prec, uint32_t *status)
+{
+    mpd_context_t maxcontext;
+    MPD_NEW_STATIC(lo,0,0,0,0);
+    MPD_NEW_STATIC(hi,0,0,0,0);
+    MPD_NEW_CONST(ulp,0,0,1,1,1,1);
+    uint32_t lostatus = 0, histatus = 0;
+    const mpd_t *c;
+    int ret = 0;
 
-    shift = MPD_MINALLOC_MAX*MPD_RDIGITS-prec;
-    shift = shift < 0 ? 0 : shift;
+    mpd_maxcontext(&maxcontext);
 
-    rnd = mpd_qshiftr(result, &_mpd_ln10, shift, status);
-    if (rnd == MPD_UINT_MAX) {
-        mpd_seterror(result, MPD_Malloc_error, status);
-        return;
+    mpd_mutex_lock(&constcache_lock);
+    c = *slot;
+    if (c == NULL) {
+        *cdigits = 0;
+        mpd_mutex_unlock(&constcache_lock);
+        return 0;
+    }
+    *cdigits = c->digits;
+    if (c->digits < prec+2) {
+        mpd_qcopy(init, c, &lostatus);
+        mpd_mutex_unlock(&constcache_lock);
+        goto out;
     }
-    result->exp = -(result->digits-1);
+    ulp.exp = c->exp;
+    mpd_qsub(&lo, c, &ulp, &maxcontext, &lostatus);
+    mpd_qadd(&hi, c, &ulp, &maxcontext, &histatus);
+    mpd_mutex_unlock(&constcache_lock);
 
-    mpd_maxcontext(&maxcontext);
-    if (prec < MPD_MINALLOC_MAX*MPD_RDIGITS) {
-        maxcontext.prec = prec;
-        _mpd_apply_round_excess(result, rnd, &maxcontext, status);
+    maxcontext.prec = prec;
+    mpd_qfinalize(&lo, &maxcontext, &lostatus);
+    mpd_qfinalize(&hi, &maxcontext, &histatus);
+    if (mpd_isspecial(&lo) || mpd_isspecial(&hi)) {
+        goto out;
+    }
+    if (mpd_cmp_total(&lo, &hi) == 0) {
+        mpd_qcopy(result, &lo, status);
         *status |= (MPD_Inexact|MPD_Rounded);
-        return;
+        ret = 1;
     }
 
-    mpd_maxcontext(&varcontext);
-    varcontext.round = MPD_ROUND_TRUNC;
-
-    i = ln_schedule_prec(klist, prec+2, -result->exp);
-    for (; i >= 0; i--) {
-        varcontext.prec = 2*klist[i]+3;
-        result->flags ^= MPD_NEG;
-        _mpd_qexp(&tmp, result, &varcontext, status);
-        result->flags ^= MPD_NEG;
-        mpd_qmul(&tmp, &static10, &tmp, &varcontext, status);
-        mpd_qsub(&tmp, &tmp, &one, &maxcontext, status);
-        mpd_qadd(result, result, &tmp, &maxcontext, status);
-        if (mpd_isspecial(result)) {
-            break;
-        }
+out:
+    if ((lostatus|histatus) & MPD_Malloc_error) {
+        mpd_seterror(result, MPD_Malloc_error, status);
+        ret = 1;
     }
-
-    mpd_del(&tmp);
-    maxcontext.prec = prec;
-    mpd_qfinalize(result, &maxcontext, status);
+    mpd_del(&lo);
+    mpd_del(&hi);
+    return ret;
 }
 
 /*
- * Initial approximations for the ln() iteration. The values have the
- * following properties (established with both decimal.py and mpfr):
- *
- * Index 0 - 400, logarithms of x in [1.00, 5.00]:
- *   abs(lnapprox[i] * 10**-3 - log((i+100)/100)) < 10**-2
- *   abs(lnapprox[i] * 10**-3 - log((i+1+100)/100)) < 10**-2
+ * Install a copy of 'v' unless the cached value is at least as long.
+ * Return 0 if the copy cannot be allocated, 1 otherwise.
+ */
+static int
+_mpd_constcache_put(mpd_t **slot, const mpd_t *v)
+{
+    uint32_t status = 0;
+    mpd_t *c;
+
+    c = mpd_qnew();
+    if (c == NULL) {
+        return 0; /* GCOV_NOT_REACHED */
+    }
+    mpd_qcopy(c, v, &status);
+    if (status & MPD_Malloc_error) {
+        mpd_del(c); /* GCOV_NOT_REACHED */
+        return 0; /* GCOV_NOT_REACHED */
+    }
+
+    mpd_mutex_lock(&constcache_lock);
+    if (*slot == NULL || (*slot)->digits < c->digits) {
+        mpd_t *old = *slot;
+        *slot = c;
+        c = old;
+    }
+    mpd_mutex_unlock(&constcache_lock);
+
+    if (c != NULL) {
+        mpd_del(c);
+    }
+    return 1;
+}
+
+/*
+ * Set 'result' to the constant in 'slot', correctly rounded to prec digits.
+ * compute(v, prec, status) sets v to the constant with prec digits and an
+ * error less than ulp(v). On entry, v is zero or a shorter approximation
+ * with the same error bound.
+ */
+static void
+_mpd_qconst(mpd_t *result, mpd_t **slot,
+            void (* compute)(mpd_t *, mpd_ssize_t, uint32_t *),
+            mpd_ssize_t prec, uint32_t *status)
+{
+    MPD_NEW_STATIC(v, 0,0,0,0);
+    mpd_ssize_t cdigits, target;
+
+    while (!_mpd_constcache_get(result, slot, &v, &cdigits, prec, status)) {
+        if (cdigits >= prec+2) {
+            /* The cached value is too close to a rounding boundary. */
+            target = 2 * cdigits;
+            _settriple(&v, MPD_POS, 0, 0);
+        }
+        else {
+            target = prec + MPD_CONSTCACHE_GUARD;
+            if (target < cdigits + cdigits/4) {
+                target = cdigits + cdigits/4;
+            }
+            if (cdigits == 0) {
+                _settriple(&v, MPD_POS, 0, 0);
+            }
+        }
+        if (mpd_isspecial(&v)) {
+            mpd_seterror(result, MPD_Malloc_error, status);
+            break;
+        }
+
+        compute(&v, target, status);
+        if (mpd_isspecial(&v)) {
+            mpd_seterror(result, MPD_Malloc_error, status);
+            break;
+        }
+        if (!_mpd_constcache_put(slot, &v)) {
+            mpd_seterror(result, MPD_Malloc_error, status);
+            break;
+        }
+    }
+
+    mpd_del(&v);
+}
+
+/* Release the cached constants. */
+void
+mpd_constcache_clear(void)
+{
+    mpd_mutex_lock(&constcache_lock);
+    if (ln10cache != NULL) {
+        mpd_del(ln10cache);
+        ln10cache = NULL;
+    }
+    if (pihalfcache != NULL) {
+        mpd_del(pihalfcache);
+        pihalfcache = NULL;
+    }
+    mpd_mutex_unlock(&constcache_lock);
+}
+
+/*
+ * Newton iteration for log(10) with prec digits. On entry, 'result' is zero
+ * or an approximation with abs(result - log(10)) < ulp(result).
+ */
+static void
+_mpd_qln10_newton(mpd_t *result, mpd_ssize_t prec, uint32_t *status)
+{
+    mpd_context_t varcontext, maxcontext;
+    MPD_NEW_STATIC(tmp, 0,0,0,0);
+    MPD_NEW_CONST(static10, 0,0,2,1,1,10);
+    mpd_ssize_t klist[MPD_MAX_PREC_LOG2];
+    int i;
+
+    if (mpd_iszero(result) || result->digits < _mpd_ln10.digits) {
+        if (!mpd_qcopy(result, &_mpd_ln10, status)) {
+            return;
+        }
+    }
+
+    mpd_maxcontext(&maxcontext);
+    mpd_maxcontext(&varcontext);
+    varcontext.round = MPD_ROUND_TRUNC;
+
+    i = ln_schedule_prec(klist, prec+2, -result->exp);
+    for (; i >= 0; i--) {
+        varcontext.prec = 2*klist[i]+3;
+        result->flags ^= MPD_NEG;
+        _mpd_qexp(&tmp, result, &varcontext, status);
+        result->flags ^= MPD_NEG;
+        mpd_qmul(&tmp, &static10, &tmp, &varcontext, status);
+        mpd_qsub(&tmp, &tmp, &one, &maxcontext, status);
+        mpd_qadd(result, result, &tmp, &maxcontext, status);
+        if (mpd_isspecial(result)) {
+            break;
+        }
+    }
+
+    mpd_del(&tmp);
+    maxcontext.prec = prec;
+    mpd_qfinalize(result, &maxcontext, status);
+}
+
+/*
+ * Set 'result' to log(10).
+ *   Ulp error: abs(result - log(10)) < ulp(log(10))
+ *   Relative error: abs(result - log(10)) < 5 * 10**-prec * log(10)
+ *
+ * NOTE: The relative error is not derived from the ulp error, but
+ * calculated separately using the fact that 23/10 < log(10) < 24/10.
+ * Results beyond the precision of _mpd_ln10 are correctly rounded.
+ */
+void
+mpd_qln10(mpd_t *result, mpd_ssize_t prec, uint32_t *status)
+{
+    mpd_context_t maxcontext;
+    mpd_uint_t rnd;
+    mpd_ssize_t shift;
+
+    assert(prec >= 1);
+
+    if (prec < MPD_MINALLOC_MAX*MPD_RDIGITS) {
+        shift = MPD_MINALLOC_MAX*MPD_RDIGITS-prec;
+        rnd = mpd_qshiftr(result, &_mpd_ln10, shift, status);
+        if (rnd == MPD_UINT_MAX) {
+            mpd_seterror(result, MPD_Malloc_error, status);
+            return;
+        }
+        result->exp = -(result->digits-1);
+
+        mpd_maxcontext(&maxcontext);
+        maxcontext.prec = prec;
+        _mpd_apply_round_excess(result, rnd, &maxcontext, status);
+        *status |= (MPD_Inexact|MPD_Rounded);
+        return;
+    }
+
+    _mpd_qconst(result, &ln10cache, _mpd_qln10_newton, prec, status);
+}
+
+/*
+ * Initial approximations for the ln() iteration. The values have the
+ * following properties (established with both decimal.py and mpfr):
+ *
+ * Index 0 - 400, logarithms of x in [1.00, 5.00]:
+ *   abs(lnapprox[i] * 10**-3 - log((i+100)/100)) < 10**-2
+ *   abs(lnapprox[i] * 10**-3 - log((i+1+100)/100)) < 10**-2
  *
  * Index 401 - 899, logarithms of x in (0.500, 0.999]:
  *   abs(-lnapprox[i] * 10**-3 - log((i+100)/1000)) < 10**-2
@@ -4880,13 +5477,164 @@ static const uint16_t lnapprox[900] = {
   18, 17, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1
 };
 
+/*
+ * Arithmetic-geometric mean for ln() at very high precision. For large s,
+ *
+ *   log(s) = pi / (2 * AGM(1, 4/s)),
+ *
+ * with a relative error of order 1/s**2. With s = v * 10**m, log(v) is
+ * pi/(2 * AGM(1, 4/s)) - m*log(10), and the special case v = 1 gives pi/2
+ * from log(10). Each AGM step needs a multiplication and a square root,
+ * and the number of steps grows with log2(prec), so this beats the Newton
+ * iteration on exp() from MPD_LN_AGM_CUTOFF words of precision.
+ *
+ * In both functions below, the work precision w has guard digits for the
+ * number of AGM steps and for log(s) < w. With m >= w/2 + 8, the error of
+ * the AGM approximation is far below 10**-w.
+ */
+#define MPD_AGM_GUARD(prec) (mpd_word_digits(prec) + 6)
+
+/*
+ * Set 'result' to AGM(1, b), 0 < b <= 1. The square roots are computed as
+ * x * 1/sqrt(x) with _mpd_qinvroot(). The iteration is stable, and the
+ * relative error is a small multiple of the number of steps times
+ * 10**(-ctx->prec+1).
+ */
+static void
+_mpd_qagm(mpd_t *result, const mpd_t *b, const mpd_context_t *ctx,
+          uint32_t *status)
+{
+    mpd_context_t varcontext;
+    mpd_t *x = result;
+    MPD_NEW_STATIC(y,0,0,0,0);
+    MPD_NEW_STATIC(p,0,0,0,0);
+    MPD_NEW_STATIC(r,0,0,0,0);
+    MPD_NEW_CONST(one_half,0,-1,1,1,1,5);
+    mpd_ssize_t conv;
+
+    varcontext = *ctx;
+    varcontext.prec = ctx->prec + 1;
+    conv = ctx->prec / 2 + 2;
+
+    _settriple(x, MPD_POS, 1, 0);
+    mpd_qcopy(&y, b, status);
+
+    while (1) {
+        /* Once x and y agree to half the digits, (x + y) / 2 is within
+         * (x - y)**2 / 8 of the mean. */
+        mpd_qsub(&r, x, &y, ctx, status);
+        if (mpd_isspecial(&r) || mpd_iszero(&r) ||
+            mpd_adjexp(&r) < mpd_adjexp(x) - conv) {
+            break;
+        }
+
+        /* y = sqrt(x * y), x = (x + y) / 2 */
+        mpd_qmul(&p, x, &y, ctx, status);
+        mpd_qadd(x, x, &y, ctx, status);
+        mpd_qmul(x, x, &one_half, ctx, status);
+        _mpd_qinvroot(&r, &p, &varcontext, status);
+        mpd_qmul(&y, &p, &r, ctx, status);
+    }
+
+    mpd_qadd(x, x, &y, ctx, status);
+    mpd_qmul(x, x, &one_half, ctx, status);
+
+    mpd_del(&y);
+    mpd_del(&p);
+    mpd_del(&r);
+}
+
+/*
+ * Set 'result' to pi/2 = m * log(10) * AGM(1, 4/10**m) with prec digits.
+ * The relative error before the final rounding is below 10**(-prec-3), so
+ * abs(result - pi/2) < ulp(result). Used through the constant cache.
+ */
+static void
+_mpd_qpihalf_agm(mpd_t *result, mpd_ssize_t prec, uint32_t *status)
+{
+    mpd_context_t workctx;
+    MPD_NEW_STATIC(b,0,0,0,0);
+    MPD_NEW_STATIC(ln10,0,0,0,0);
+    mpd_ssize_t m, w;
+
+    w = prec + MPD_AGM_GUARD(prec);
+    m = w / 2 + 8;
+
+    mpd_maxcontext(&workctx);
+    workctx.prec = w;
+    workctx.round = MPD_ROUND_HALF_EVEN;
+
+    _settriple(&b, MPD_POS, 4, -m);
+    _mpd_qagm(result, &b, &workctx, status);
+    mpd_qln10(&ln10, w, status);
+    mpd_qmul(result, result, &ln10, &workctx, status);
+    mpd_qmul_ssize(result, result, m, &workctx, status);
+
+    workctx.prec = prec;
+    mpd_qfinalize(result, &workctx, status);
+
+    mpd_del(&b);
+    mpd_del(&ln10);
+}
+
+/*
+ * Set 'z' to log(v), 0.5 < v <= 5, using the AGM.
+ *   Absolute error: abs(z - log(v)) < 10**-maxprec
+ */
+static void
+_mpd_qln_agm(mpd_t *z, const mpd_t *v, mpd_ssize_t maxprec,
+             uint32_t *status)
+{
+    mpd_context_t workctx, maxcontext;
+    MPD_NEW_STATIC(a,0,0,0,0);
+    MPD_NEW_STATIC(b,0,0,0,0);
+    MPD_NEW_CONST(four,0,0,1,1,1,4);
+    mpd_ssize_t m, w;
+
+    w = maxprec + MPD_AGM_GUARD(maxprec);
+    m = w / 2 + 8;
+
+    mpd_maxcontext(&maxcontext);
+    mpd_maxcontext(&workctx);
+    workctx.prec = w;
+    workctx.round = MPD_ROUND_HALF_EVEN;
+
+    /* a = AGM(1, 4/(v * 10**m)) */
+    mpd_qdiv(&b, &four, v, &workctx, status);
+    b.exp -= m;
+    _mpd_qagm(&a, &b, &workctx, status);
+
+    /* z = pi/(2*a) - m*log(10) */
+    _mpd_qconst(&b, &pihalfcache, _mpd_qpihalf_agm, w, status);
+    mpd_qdiv(z, &b, &a, &workctx, status);
+    mpd_qln10(&a, w, status);
+    mpd_qmul_ssize(&b, &a, m, &maxcontext, status);
+    mpd_qsub(z, z, &b, &maxcontext, status);
+
+    mpd_del(&a);
+    mpd_del(&b);
+}
+
+/*
+ * State of the ln() iteration, kept across the retries of the Ziv loops in
+ * mpd_qln() and mpd_qlog10(). 'z' approximates log(v) for the reduced
+ * operand v with abs(z - log(v)) < 10**-prec, or prec is 0. A retry at a
+ * higher precision continues the Newton iteration from z, which usually
+ * takes a single step.
+ */
+struct _mpd_ln_state {
+    mpd_t *z;
+    mpd_ssize_t prec;
+};
+
 /*
  * Internal ln() function that does not check for specials, zero or one.
  * Relative error: abs(result - log(a)) < 0.1 * 10**-prec * abs(log(a))
+ * 'st' is NULL or the state of the previous attempt for the same 'a'.
  */
 static int
 _mpd_qln(mpd_t *result, const mpd_t *a, const mpd_context_t *ctx,
-         uint32_t *status)
+         struct _mpd_ln_state *st, uint32_t *status)
 {
     mpd_context_t varcontext, maxcontext;
     mpd_t *z = result;
@@ -4894,7 +5642,7 @@ _mpd_qln(mpd_t *result, const mpd_t *a, const mpd_context_t *ctx,
     MPD_NEW_STATIC(vtmp,0,0,0,0);
     MPD_NEW_STATIC(tmp,0,0,0,0);
     mpd_ssize_t klist[MPD_MAX_PREC_LOG2];
-    mpd_ssize_t maxprec, shift, t;
+    mpd_ssize_t maxprec, initprec, shift, t;
     mpd_ssize_t a_digits, a_exp;
     mpd_uint_t dummy, x;
     int ret = 1;
@@ -4992,27 +5740,50 @@ _mpd_qln(mpd_t *result, const mpd_t *a, const mpd_context_t *ctx,
         }
     }
 
-    i = ln_schedule_prec(klist, maxprec, 2);
-    for (; i >= 0; i--) {
-        varcontext.prec = 2*klist[i]+3;
-        z->flags ^= MPD_NEG;
-        _mpd_qexp(&tmp, z, &varcontext, status);
-        z->flags ^= MPD_NEG;
-
-        if (v.digits > varcontext.prec) {
-            shift = v.digits - varcontext.prec;
-            mpd_qshiftr(&vtmp, &v, shift, status);
-            vtmp.exp += shift;
-            mpd_qmul(&tmp, &vtmp, &tmp, &varcontext, status);
+    /* abs(z - log(v)) < 10**-initprec */
+    initprec = 2;
+    if (st != NULL && st->prec > initprec) {
+        if (!mpd_qcopy(z, st->z, status)) {
+            mpd_seterror(result, MPD_Malloc_error, status);
+            goto finish;
         }
-        else {
-            mpd_qmul(&tmp, &v, &tmp, &varcontext, status);
+        initprec = st->prec;
+    }
+
+    if (initprec == 2 && maxprec / MPD_RDIGITS >= MPD_LN_AGM_CUTOFF) {
+        _mpd_qln_agm(z, &v, maxprec, status);
+    }
+    else {
+        i = ln_schedule_prec(klist, maxprec, initprec);
+        for (; i >= 0; i--) {
+            varcontext.prec = 2*klist[i]+3;
+            z->flags ^= MPD_NEG;
+            _mpd_qexp(&tmp, z, &varcontext, status);
+            z->flags ^= MPD_NEG;
+
+            if (v.digits > varcontext.prec) {
+                shift = v.digits - varcontext.prec;
+                mpd_qshiftr(&vtmp, &v, shift, status);
+                vtmp.exp += shift;
+                mpd_qmul(&tmp, &vtmp, &tmp, &varcontext, status);
+            }
+            else {
+                mpd_qmul(&tmp, &v, &tmp, &varcontext, status);
+            }
+
+            mpd_qsub(&tmp, &tmp, &one, &maxcontext, status);
+            mpd_qadd(z, z, &tmp, &maxcontext, status);
+            if (mpd_isspecial(z)) {
+                break;
+            }
         }
+    }
 
-        mpd_qsub(&tmp, &tmp, &one, &maxcontext, status);
-        mpd_qadd(z, z, &tmp, &maxcontext, status);
-        if (mpd_isspecial(z)) {
-            break;
+    if (st != NULL) {
+        uint32_t ststatus = 0;
+        st->prec = 0;
+        if (!mpd_isspecial(z) && mpd_qcopy(st->z, z, &ststatus)) {
+            st->prec = maxprec;
         }
     }
 
@@ -5123,6 +5894,8 @@ mpd_qln(mpd_t *result, const mpd_t *a, const mpd_context_t *ctx,
         MPD_NEW_STATIC(lo, 0,0,0,0);
         MPD_NEW_STATIC(ulp, 0,0,0,0);
         MPD_NEW_STATIC(aa, 0,0,0,0);
+        MPD_NEW_STATIC(lnz, 0,0,0,0);
+        struct _mpd_ln_state st = {&lnz, 0};
         uint32_t loop_protect = 0;
         mpd_ssize_t prec;
 
@@ -5145,7 +5918,7 @@ mpd_qln(mpd_t *result, const mpd_t *a, const mpd_context_t *ctx,
             int subnormal_eq;
 
             workctx.prec = prec;
-            shortcut = _mpd_qln(result, a, &workctx, &status_res);
+            shortcut = _mpd_qln(result, a, &workctx, &st, &status_res);
             if (mpd_isnan(result)) {
                 mpd_seterror(result, status_res, status);
                 break;
@@ -5203,9 +5976,10 @@ mpd_qln(mpd_t *result, const mpd_t *a, const mpd_context_t *ctx,
         mpd_del(&lo);
         mpd_del(&ulp);
         mpd_del(&aa);
+        mpd_del(&lnz);
     }
     else {
-        _mpd_qln(result, a, &workctx, status);
+        _mpd_qln(result, a, &workctx, NULL, status);
         mpd_check_underflow(result, &workctx, status);
         mpd_qfinalize(result, &workctx, status);
     }
@@ -5221,7 +5995,8 @@ mpd_qln(mpd_t *result, const mpd_t *a, const mpd_context_t *ctx,
 enum {SKIP_FINALIZE, DO_FINALIZE};
 static int
 _mpd_qlog10(int action, mpd_t *result, const mpd_t *a,
-            const mpd_context_t *ctx, uint32_t *status)
+            const mpd_context_t *ctx, struct _mpd_ln_state *st,
+            uint32_t *status)
 {
     mpd_context_t workctx;
     MPD_NEW_STATIC(ln10,0,0,0,0);
@@ -5231,7 +6006,7 @@ _mpd_qlog10(int action, mpd_t *result, const mpd_t *a,
     workctx.prec = ctx->prec + 3;
     /* relative error: 0.1 * 10**(-p-3). The specific underflow shortcut
      * in _mpd_qln() does not change the final result. */
-    ret = _mpd_qln(result, a, &workctx, status);
+    ret = _mpd_qln(result, a, &workctx, st, status);
     /* relative error: 5 * 10**(-p-3) */
     mpd_qln10(&ln10, workctx.prec, status);
 
@@ -5240,7 +6015,7 @@ _mpd_qlog10(int action, mpd_t *result, const mpd_t *a,
         workctx.round = MPD_ROUND_HALF_EVEN;
     }
     /* SKIP_FINALIZE: relative error: 5 * 10**(-p-3) */
-    _mpd_qdiv(NO_IDEAL_EXP, result, result, &ln10, &workctx, status);
+    _mpd_qdiv(NO_IDEAL_EXP, result, result, &ln10, NULL, &workctx, status);
 
     mpd_del(&ln10);
     return ret;
@@ -5320,6 +6095,8 @@ mpd_qlog10(mpd_t *result, const mpd_t *a, const mpd_context_t *ctx,
         MPD_NEW_STATIC(lo, 0,0,0,0);
         MPD_NEW_STATIC(ulp, 0,0,0,0);
         MPD_NEW_STATIC(aa, 0,0,0,0);
+        MPD_NEW_STATIC(lnz, 0,0,0,0);
+        struct _mpd_ln_state st = {&lnz, 0};
         uint32_t loop_protect = 0;
         mpd_ssize_t prec;
 
@@ -5342,7 +6119,8 @@ mpd_qlog10(mpd_t *result, const mpd_t *a, const mpd_context_t *ctx,
             int subnormal_eq;
 
             workctx.prec = prec;
-            shortcut = _mpd_qlog10(SKIP_FINALIZE, result, a, &workctx, &status_res);
+            shortcut = _mpd_qlog10(SKIP_FINALIZE, result, a, &workctx, &st,
+                                   &status_res);
             if (mpd_isnan(result)) {
                 mpd_seterror(result, status_res, status);
                 break;
@@ -5400,9 +6178,10 @@ mpd_qlog10(mpd_t *result, const mpd_t *a, const mpd_context_t *ctx,
         mpd_del(&lo);
         mpd_del(&ulp);
         mpd_del(&aa);
+        mpd_del(&lnz);
     }
     else {
-        _mpd_qlog10(DO_FINALIZE, result, a, &workctx, status);
+        _mpd_qlog10(DO_FINALIZE, result, a, &workctx, NULL, status);
         mpd_check_underflow(result, &workctx, status);
     }
 }
@@ -5584,8 +6363,6 @@ _kmul_worksize(mpd_size_t n, mpd_size_t lim)
 }
 
 
-#define MPD_KARATSUBA_BASECASE 16  /* must be >= 4 */
-
 /*
  * Add the product of a and b to c.
  * c must be _kmul_resultsize(la, lb) in size.
@@ -5698,49 +6475,334 @@ _mpd_kmul(const mpd_uint_t *u, const mpd_uint_t *v,
 }
 
 
+/******************************************************************************/
+/*                         Toom-Cook multiplication                           */
+/******************************************************************************/
+
 /*
- * Determine the minimum length for the number theoretic transform. Valid
- * transform lengths are 2**n or 3*2**n, where 2**n <= MPD_MAXTRANSFORM_2N.
- * The function finds the shortest length m such that rsize <= m.
+ * Toom-3 splits the operands into three parts of k words and evaluates the
+ * resulting polynomials at the points 0, 1, -1, 2 and infinity. The five
+ * pointwise products are combined with the interpolation sequence by
+ * M. Bodrato and A. Zanoni, "Integer and Polynomial Multiplication: Towards
+ * Optimal Toom-Cook Matrices", ISSAC 2007. All coefficients of the product
+ * polynomial are non-negative, and the sequence below is ordered such that
+ * every intermediate value except the product at -1 is non-negative as
+ * well, so the unsigned base arithmetic functions can be used throughout.
+ *
+ * Below MPD_TOOM3_BASECASE words the recursion continues with Karatsuba.
  */
-static inline mpd_size_t
-_mpd_get_transform_len(mpd_size_t rsize)
-{
-    mpd_size_t log2rsize;
-    mpd_size_t x, step;
 
-    assert(rsize >= 4);
-    log2rsize = mpd_bsr(rsize);
+/*
+ * Toom-3 is faster than the number theoretic transform for operands up to
+ * about MPD_TOOM_FNT_CUTOFF words only if the transform is not vectorized
+ * and the base arithmetic uses the 64-bit multiplication instructions.
+ * This is the default if MPD_TUNE_TOOM_FNT_CUTOFF is -1.
+ */
+#if defined(CONFIG_64) && defined(ASM)
+  #define MPD_TOOM_FNT_CUTOFF 768
+#else
+  #define MPD_TOOM_FNT_CUTOFF 0
+#endif
 
-    if (rsize <= 1024) {
-        /* 2**n is faster in this range. */
-        x = ((mpd_size_t)1)<<log2rsize;
-        return (rsize == x) ? x : x<<1;
-    }
-    else if (rsize <= MPD_MAXTRANSFORM_2N) {
-        x = ((mpd_size_t)1)<<log2rsize;
-        if (rsize == x) return x;
-        step = x>>1;
-        x += step;
-        return (rsize <= x) ? x : x + step;
-    }
-    else if (rsize <= MPD_MAXTRANSFORM_2N+MPD_MAXTRANSFORM_2N/2) {
-        return MPD_MAXTRANSFORM_2N+MPD_MAXTRANSFORM_2N/2;
-    }
-    else if (rsize <= 3*MPD_MAXTRANSFORM_2N) {
-        return 3*MPD_MAXTRANSFORM_2N;
+/* Compare u (len n+1) and v (len n). */
+static inline int
+_toom_cmp(const mpd_uint_t *u, const mpd_uint_t *v, mpd_size_t n)
+{
+    mpd_size_t i;
+
+    if (u[n] != 0) {
+        return 1;
     }
-    else {
-        return MPD_SIZE_MAX;
+    for (i = n-1; i != MPD_SIZE_MAX; i--) {
+        if (u[i] != v[i]) {
+            return u[i] < v[i] ? -1 : 1;
+        }
     }
+    return 0;
 }
 
-#ifdef PPRO
-#ifndef _MSC_VER
-static inline unsigned short
-_mpd_get_control87(void)
+/* Length of u (len n) without leading zero words. */
+static inline mpd_size_t
+_toom_trim(const mpd_uint_t *u, mpd_size_t n)
 {
-    unsigned short cw;
+    while (n > 0 && u[n-1] == 0) {
+        n--;
+    }
+    return n;
+}
+
+/*
+ * Evaluate a = a0 + a1*X + a2*X**2 (parts of k, k and la-2k words) at the
+ * points 1, -1 and 2. Each result array must be k+2 in size and receives
+ * k+1 significant words. Returns the sign of a(-1).
+ */
+static int
+_toom3_eval(mpd_uint_t *e1, mpd_uint_t *em1, mpd_uint_t *e2,
+            const mpd_uint_t *a, mpd_size_t la, mpd_size_t k)
+{
+    const mpd_uint_t *a0 = a, *a1 = a+k, *a2 = a+2*k;
+    mpd_size_t la2 = la-2*k;
+    int sign = 0;
+
+    /* em1 := a0 + a2 */
+    em1[k] = _mpd_baseadd(em1, a0, a2, k, la2);
+
+    /* e1 := a0 + a1 + a2 */
+    (void)_mpd_baseadd(e1, em1, a1, k+1, k);
+
+    /* em1 := |a0 - a1 + a2| */
+    if (_toom_cmp(em1, a1, k) >= 0) {
+        _mpd_basesub(em1, em1, a1, k+1, k);
+    }
+    else {
+        _mpd_basesub(em1, a1, em1, k, k);
+        em1[k] = 0;
+        sign = 1;
+    }
+
+    /* e2 := (2*a2 + a1)*2 + a0 */
+    mpd_uint_zero(e2, k+2);
+    _mpd_shortmul(e2, a2, la2, 2);
+    _mpd_baseaddto(e2, a1, k);
+    _mpd_shortmul(e2, e2, k+1, 2);
+    _mpd_baseaddto(e2, a0, k);
+
+    return sign;
+}
+
+/* Work space needed in _toom_mul(). */
+static mpd_size_t
+_toom_worksize(mpd_size_t la, mpd_size_t lb)
+{
+    mpd_size_t k, m, n, x;
+
+    if (lb <= MPD_TOOM3_BASECASE) {
+        return add_size_t(_kmul_resultsize(la, lb),
+                          _kmul_worksize(la, MPD_KARATSUBA_BASECASE));
+    }
+
+    k = (la+2)/3;
+    if (lb <= 2*k) {
+        m = _toom_worksize(lb, lb);
+        n = la % lb;
+        if (n != 0) {
+            x = _toom_worksize(lb, n);
+            m = (x > m) ? x : m;
+        }
+        return add_size_t(mul_size_t(lb, 2), m);
+    }
+
+    m = _toom_worksize(k+1, k+1);
+    x = _toom_worksize(la-2*k, lb-2*k);
+    m = (x > m) ? x : m;
+
+    /* six evaluations, three products and one temporary */
+    n = add_size_t(mul_size_t(6, k+2), mul_size_t(4, 2*k+3));
+
+    return add_size_t(n, m);
+}
+
+/*
+ * c := a * b. c must be la+lb in size and is overwritten.
+ * w is used as a work array and must be _toom_worksize(la, lb) in size.
+ * If a and b are the same array of the same length, the squaring variant
+ * is used: the evaluations are done once and all pointwise products are
+ * squarings.
+ */
+static void
+_toom_mul(mpd_uint_t *c, const mpd_uint_t *a, const mpd_uint_t *b,
+          mpd_uint_t *w, mpd_size_t la, mpd_size_t lb)
+{
+    mpd_uint_t *ea1, *eam1, *ea2, *eb1, *ebm1, *eb2;
+    mpd_uint_t *v1, *vm1, *v2, *t;
+    mpd_size_t k, l, l4, n, i;
+    int sqr = (a == b && la == lb);
+    int sign;
+
+    assert(la >= lb && lb > 0);
+
+    if (lb <= MPD_TOOM3_BASECASE) {
+        n = _kmul_resultsize(la, lb);
+        mpd_uint_zero(w, n);
+        _karatsuba_rec(w, a, b, w+n, la, lb);
+        memcpy(c, w, (la+lb) * sizeof *c);
+        return;
+    }
+
+    k = (la+2)/3;  /* ceil(la/3) */
+
+    /* Unbalanced: cut a into pieces of length lb. */
+    if (lb <= 2*k) {
+        mpd_uint_zero(c, la+lb);
+        for (i = 0; i < la; i += lb) {
+            n = (la-i < lb) ? la-i : lb;
+            if (n == lb) {
+                _toom_mul(w, a+i, b, w+2*lb, lb, lb);
+            }
+            else {
+                _toom_mul(w, b, a+i, w+2*lb, lb, n);
+            }
+            _mpd_baseaddto(c+i, w, n+lb);
+        }
+        return;
+    }
+
+    /* la >= lb > 2k, la-2k >= 1 */
+    l = 2*k+2;     /* length of the pointwise products */
+    l4 = (la-2*k) + (lb-2*k);
+
+    ea1 = w;      eam1 = ea1+(k+2); ea2 = eam1+(k+2);
+    eb1 = ea2+(k+2); ebm1 = eb1+(k+2); eb2 = ebm1+(k+2);
+    v1 = eb2+(k+2); vm1 = v1+(l+1); v2 = vm1+(l+1); t = v2+(l+1);
+    w = t+(l+1);
+
+    sign = _toom3_eval(ea1, eam1, ea2, a, la, k);
+    if (sqr) {
+        _toom_mul(v1, ea1, ea1, w, k+1, k+1);
+        _toom_mul(vm1, eam1, eam1, w, k+1, k+1);
+        _toom_mul(v2, ea2, ea2, w, k+1, k+1);
+        _toom_mul(c, a, a, w, k, k);
+        _toom_mul(c+4*k, a+2*k, a+2*k, w, la-2*k, lb-2*k);
+        sign = 0;
+    }
+    else {
+        sign ^= _toom3_eval(eb1, ebm1, eb2, b, lb, k);
+        _toom_mul(v1, ea1, eb1, w, k+1, k+1);
+        _toom_mul(vm1, eam1, ebm1, w, k+1, k+1);
+        _toom_mul(v2, ea2, eb2, w, k+1, k+1);
+        _toom_mul(c, a, b, w, k, k);
+        _toom_mul(c+4*k, a+2*k, b+2*k, w, la-2*k, lb-2*k);
+    }
+    mpd_uint_zero(c+2*k, 2*k);
+
+    /* t := (v1 + vm1) / 2 = r0 + r2 + r4 */
+    /* v1 := (v1 - vm1) / 2 = r1 + r3 */
+    if (sign) {
+        _mpd_basesub(t, v1, vm1, l, l);
+        (void)_mpd_baseadd(v1, v1, vm1, l, l);
+    }
+    else {
+        (void)_mpd_baseadd(t, v1, vm1, l, l);
+        _mpd_basesub(v1, v1, vm1, l, l);
+    }
+    (void)_mpd_shortdiv(t, t, l, 2);
+    (void)_mpd_shortdiv(v1, v1, l, 2);
+
+    /* t := r2 */
+    _mpd_basesubfrom(t, c, 2*k);
+    _mpd_basesubfrom(t, c+4*k, l4);
+
+    /* v2 := (v2 - r0 - 4*r2 - 16*r4 - 2*(r1+r3)) / 6 = r3 */
+    _mpd_basesubfrom(v2, c, 2*k);
+    _mpd_shortmul(vm1, t, l, 4);
+    _mpd_basesubfrom(v2, vm1, l);
+    _mpd_shortmul(vm1, c+4*k, l4, 16);
+    _mpd_basesubfrom(v2, vm1, l4+1);
+    _mpd_shortmul(vm1, v1, l, 2);
+    _mpd_basesubfrom(v2, vm1, l);
+    (void)_mpd_shortdiv(v2, v2, l, 6);
+
+    /* v1 := r1 */
+    _mpd_basesubfrom(v1, v2, l);
+
+    _mpd_baseaddto(c+k, v1, _toom_trim(v1, l));
+    _mpd_baseaddto(c+2*k, t, _toom_trim(t, l));
+    _mpd_baseaddto(c+3*k, v2, _toom_trim(v2, l));
+}
+
+/* Largest length of the smaller operand for which _mpd_tmul() is used. */
+static inline mpd_size_t
+_mpd_toom_cutoff(void)
+{
+    if (_mpd_tune[MPD_TUNE_TOOM_FNT_CUTOFF] >= 0) {
+        return (mpd_size_t)_mpd_tune[MPD_TUNE_TOOM_FNT_CUTOFF];
+    }
+#ifdef MPD_FNT_SIMD
+    if (_mpd_simd.mulmod != NULL) {
+        return 0;
+    }
+#endif
+    return MPD_TOOM_FNT_CUTOFF;
+}
+
+/*
+ * Multiply u and v, using Toom-Cook multiplication. Returns a pointer
+ * to the result or NULL in case of failure (malloc error).
+ * Conditions: ulen >= vlen > 0
+ */
+static mpd_uint_t *
+_mpd_tmul(const mpd_uint_t *u, const mpd_uint_t *v,
+          mpd_size_t ulen, mpd_size_t vlen,
+          mpd_size_t *rsize)
+{
+    mpd_uint_t *result = NULL, *w = NULL;
+    mpd_size_t m;
+
+    assert(vlen > 0);
+    assert(ulen >= vlen);
+
+    *rsize = add_size_t(ulen, vlen);
+    if ((result = mpd_alloc(*rsize, sizeof *result)) == NULL) {
+        return NULL;
+    }
+
+    m = _toom_worksize(ulen, vlen);
+    if ((w = mpd_alloc(m, sizeof *w)) == NULL) {
+        mpd_free(result);
+        return NULL;
+    }
+
+    _toom_mul(result, u, v, w, ulen, vlen);
+
+
+    mpd_free(w);
+    return result;
+}
+
+
+/*
+ * Determine the minimum length for the number theoretic transform. Valid
+ * transform lengths are 2**n or 3*2**n, where 2**n <= MPD_MAXTRANSFORM_2N.
+ * The function finds the shortest length m such that rsize <= m.
+ */
+static inline mpd_size_t
+_mpd_get_transform_len(mpd_size_t rsize)
+{
+    mpd_size_t log2rsize;
+    mpd_size_t x, step;
+
+    assert(rsize >= 4);
+    log2rsize = mpd_bsr(rsize);
+
+    if (rsize <= MPD_POW2_CUTOFF) {
+        /* 2**n is faster in this range. */
+        x = ((mpd_size_t)1)<<log2rsize;
+        return (rsize == x) ? x : x<<1;
+    }
+    else if (rsize <= MPD_MAXTRANSFORM_2N) {
+        x = ((mpd_size_t)1)<<log2rsize;
+        if (rsize == x) return x;
+        step = x>>1;
+        x += step;
+        return (rsize <= x) ? x : x + step;
+    }
+    else if (rsize <= MPD_MAXTRANSFORM_2N+MPD_MAXTRANSFORM_2N/2) {
+        return MPD_MAXTRANSFORM_2N+MPD_MAXTRANSFORM_2N/2;
+    }
+    else if (rsize <= 3*MPD_MAXTRANSFORM_2N) {
+        return 3*MPD_MAXTRANSFORM_2N;
+    }
+    else {
+        return MPD_SIZE_MAX;
+    }
+}
+
+#ifdef PPRO
+#ifndef _MSC_VER
+static inline unsigned short
+_mpd_get_control87(void)
+{
+    unsigned short cw;
 
     __asm__ __volatile__ ("fnstcw %0" : "=m" (cw));
     return cw;
@@ -5753,7 +6815,7 @@ _mpd_set_control87(unsigned short cw)
 }
 #endif
 
-static unsigned int
+unsigned int
 mpd_set_fenv(void)
 {
     unsigned int cw;
@@ -5773,7 +6835,7 @@ mpd_set_fenv(void)
     return cw;
 }
 
-static void
+void
 mpd_restore_fenv(unsigned int cw)
 {
 #ifdef _MSC_VER
@@ -5787,6 +6849,144 @@ mpd_restore_fenv(unsigned int cw)
 }
 #endif /* PPRO */
 
+/* One modular convolution of _mpd_fntmul(), run in a helper thread. */
+struct fnt_task {
+    mpd_uint_t *c;          /* copy of u on entry, result on exit */
+    const mpd_uint_t *v;    /* NULL for an autoconvolution */
+    const mpd_uint_t *vt;   /* forward transform of v from a plan, or NULL */
+    mpd_size_t vlen;
+    mpd_size_t n;
+    int modnum;
+    int ok;
+};
+
+static void
+_mpd_fnt_task(void *arg)
+{
+    struct fnt_task *t = arg;
+    mpd_uint_t *vtmp;
+
+#ifdef PPRO
+    unsigned int cw;
+    cw = mpd_set_fenv();
+#endif
+
+    if (t->vt != NULL) {
+        t->ok = fnt_convolute_trans(t->c, t->vt, t->n, t->modnum);
+    }
+    else if (t->v == NULL) {
+        t->ok = fnt_autoconvolute(t->c, t->n, t->modnum);
+    }
+    else if ((vtmp = mpd_calloc(t->n, sizeof *vtmp)) == NULL) {
+        t->ok = 0;
+    }
+    else {
+        /* Each convolution gets its own copy of v. */
+        memcpy(vtmp, t->v, t->vlen * (sizeof *vtmp));
+        t->ok = fnt_convolute(t->c, vtmp, t->n, t->modnum);
+        mpd_free(vtmp);
+    }
+
+#ifdef PPRO
+    mpd_restore_fenv(cw);
+#endif
+}
+
+/* Run the three convolutions of _mpd_fntmul() concurrently. If vt is not
+   NULL, it holds the forward transforms of v for each modulus. */
+static int
+_mpd_fnt_parallel(mpd_uint_t *c1, mpd_uint_t *c2, mpd_uint_t *c3,
+                  const mpd_uint_t *v, mpd_uint_t *const *vt,
+                  mpd_size_t vlen, mpd_size_t n)
+{
+    struct fnt_task task[3];
+    void *args[3];
+    mpd_uint_t *c[3];
+    int i;
+
+    c[P1] = c1; c[P2] = c2; c[P3] = c3;
+
+    for (i = P1; i <= P3; i++) {
+        task[i].c = c[i];
+        task[i].v = v;
+        task[i].vt = (vt == NULL) ? NULL : vt[i];
+        task[i].vlen = vlen;
+        task[i].n = n;
+        task[i].modnum = i;
+        task[i].ok = 0;
+        args[i] = &task[i];
+    }
+
+    _mpd_run_tasks(_mpd_fnt_task, args, 3);
+
+    return task[P1].ok && task[P2].ok && task[P3].ok;
+}
+
+/*
+ * Low-memory variant of _mpd_fntmul() for transform length n. The
+ * convolutions for the three moduli are computed one after the other
+ * in the same two buffers, and each one is added to the result by
+ * crt_add(). Peak memory is the result, 2*n words and rsize bytes instead
+ * of four buffers of n words. Returns a pointer to the result or NULL in
+ * case of failure (malloc error).
+ */
+static mpd_uint_t *
+_mpd_fntmul_lowmem(const mpd_uint_t *u, const mpd_uint_t *v,
+                   mpd_size_t ulen, mpd_size_t vlen,
+                   mpd_size_t n, mpd_size_t rsize)
+{
+    mpd_uint_t *w = NULL, *c = NULL, *vtmp = NULL;
+    unsigned char *frac = NULL;
+    int modnum;
+
+    if ((w = mpd_calloc(rsize+MPD_CRT_EXTRA, sizeof *w)) == NULL) {
+        goto malloc_error;
+    }
+    if ((frac = mpd_calloc(rsize, sizeof *frac)) == NULL) {
+        goto malloc_error;
+    }
+    if ((c = mpd_alloc(n, sizeof *c)) == NULL) {
+        goto malloc_error;
+    }
+    if (u != v && (vtmp = mpd_alloc(n, sizeof *vtmp)) == NULL) {
+        goto malloc_error;
+    }
+
+    for (modnum = P1; modnum <= P3; modnum++) {
+        memcpy(c, u, ulen * (sizeof *c));
+        mpd_uint_zero(c+ulen, n-ulen);
+
+        if (u == v) {
+            if (!fnt_autoconvolute(c, n, modnum)) {
+                goto malloc_error;
+            }
+        }
+        else {
+            memcpy(vtmp, v, vlen * (sizeof *vtmp));
+            mpd_uint_zero(vtmp+vlen, n-vlen);
+            if (!fnt_convolute(c, vtmp, n, modnum)) {
+                goto malloc_error;
+            }
+        }
+
+        crt_add(w, frac, c, rsize, modnum);
+    }
+
+    crt_finish(w, frac, rsize);
+
+
+out:
+    if (c) mpd_free(c);
+    if (vtmp) mpd_free(vtmp);
+    if (frac) mpd_free(frac);
+    return w;
+
+malloc_error:
+    if (w) mpd_free(w);
+    w = NULL;
+    goto out;
+}
+
 /*
  * Multiply u and v, using the fast number theoretic transform. Returns
  * a pointer to the result or NULL in case of failure (malloc error).
@@ -5809,6 +7009,11 @@ _mpd_fntmul(const mpd_uint_t *u, const mpd_uint_t *v,
         goto malloc_error;
     }
 
+    if (n >= MPD_LOWMEM_FNT_CUTOFF) {
+        c1 = _mpd_fntmul_lowmem(u, v, ulen, vlen, n, *rsize);
+        goto out;
+    }
+
     if ((c1 = mpd_calloc(n, sizeof *c1)) == NULL) {
         goto malloc_error;
     }
@@ -5823,7 +7028,12 @@ _mpd_fntmul(const mpd_uint_t *u, const mpd_uint_t *v,
     memcpy(c2, u, ulen * (sizeof *c2));
     memcpy(c3, u, ulen * (sizeof *c3));
 
-    if (u == v) {
+    if (mpd_getfntparallel() && n >= MPD_PARALLEL_FNT_CUTOFF) {
+        if (!_mpd_fnt_parallel(c1, c2, c3, (u == v) ? NULL : v, NULL, vlen, n)) {
+            goto malloc_error;
+        }
+    }
+    else if (u == v) {
         if (!fnt_autoconvolute(c1, n, P1) ||
             !fnt_autoconvolute(c2, n, P2) ||
             !fnt_autoconvolute(c3, n, P3)) {
@@ -5875,40 +7085,111 @@ malloc_error:
 }
 
 
+/* Pre-transformed operand for repeated multiplications. */
+struct mpd_mulplan_t {
+    mpd_t *v;           /* copy of the operand */
+    mpd_size_t n;       /* transform length, 0 if the plan has no transforms */
+    mpd_uint_t *t[3];   /* forward transforms of v->data for P1, P2, P3 */
+};
+
 /*
- * Karatsuba multiplication with FNT/basemul as the base case.
+ * Multiply u by the operand of a plan, using the stored transforms.
+ * Returns a pointer to the result or NULL in case of failure (malloc
+ * error). Condition: ulen + plan->v->len <= plan->n.
  */
-static int
-_karatsuba_rec_fnt(mpd_uint_t *c, const mpd_uint_t *a, const mpd_uint_t *b,
-                   mpd_uint_t *w, mpd_size_t la, mpd_size_t lb)
+static mpd_uint_t *
+_mpd_fntmul_plan(const mpd_uint_t *u, mpd_size_t ulen,
+                 const mpd_mulplan_t *plan, mpd_size_t *rsize)
 {
-    mpd_size_t m, lt;
-
-    assert(la >= lb && lb > 0);
-    assert(la <= 3*(MPD_MAXTRANSFORM_2N/2) || w != NULL);
+    mpd_uint_t *c1 = NULL, *c2 = NULL, *c3 = NULL;
+    mpd_size_t n = plan->n;
 
-    if (la <= 3*(MPD_MAXTRANSFORM_2N/2)) {
+#ifdef PPRO
+    unsigned int cw;
+    cw = mpd_set_fenv();
+#endif
 
-        if (lb <= 192) {
-            _mpd_basemul(c, b, a, lb, la);
-        }
-        else {
-            mpd_uint_t *result;
-            mpd_size_t dummy;
+    *rsize = add_size_t(ulen, plan->v->len);
+    assert(*rsize <= n);
 
-            if ((result = _mpd_fntmul(a, b, la, lb, &dummy)) == NULL) {
-                return 0;
-            }
-            memcpy(c, result, (la+lb) * (sizeof *result));
-            mpd_free(result);
-        }
-        return 1;
+    if ((c1 = mpd_calloc(n, sizeof *c1)) == NULL) {
+        goto malloc_error;
+    }
+    if ((c2 = mpd_calloc(n, sizeof *c2)) == NULL) {
+        goto malloc_error;
+    }
+    if ((c3 = mpd_calloc(n, sizeof *c3)) == NULL) {
+        goto malloc_error;
     }
 
-    m = (la+1)/2;  /* ceil(la/2) */
+    memcpy(c1, u, ulen * (sizeof *c1));
+    memcpy(c2, u, ulen * (sizeof *c2));
+    memcpy(c3, u, ulen * (sizeof *c3));
 
-    /* lb <= m < la */
-    if (lb <= m) {
+    if (mpd_getfntparallel() && n >= MPD_PARALLEL_FNT_CUTOFF) {
+        if (!_mpd_fnt_parallel(c1, c2, c3, NULL, plan->t, 0, n)) {
+            goto malloc_error;
+        }
+    }
+    else {
+        if (!fnt_convolute_trans(c1, plan->t[P1], n, P1) ||
+            !fnt_convolute_trans(c2, plan->t[P2], n, P2) ||
+            !fnt_convolute_trans(c3, plan->t[P3], n, P3)) {
+            goto malloc_error;
+        }
+    }
+
+    crt3(c1, c2, c3, *rsize);
+
+out:
+#ifdef PPRO
+    mpd_restore_fenv(cw);
+#endif
+    if (c2) mpd_free(c2);
+    if (c3) mpd_free(c3);
+    return c1;
+
+malloc_error:
+    if (c1) mpd_free(c1);
+    c1 = NULL;
+    goto out;
+}
+
+
+/*
+ * Karatsuba multiplication with FNT/basemul as the base case.
+ */
+static int
+_karatsuba_rec_fnt(mpd_uint_t *c, const mpd_uint_t *a, const mpd_uint_t *b,
+                   mpd_uint_t *w, mpd_size_t la, mpd_size_t lb)
+{
+    mpd_size_t m, lt;
+
+    assert(la >= lb && lb > 0);
+    assert(la <= 3*(MPD_MAXTRANSFORM_2N/2) || w != NULL);
+
+    if (la <= 3*(MPD_MAXTRANSFORM_2N/2)) {
+
+        if (lb <= 192) {
+            _mpd_basemul(c, b, a, lb, la);
+        }
+        else {
+            mpd_uint_t *result;
+            mpd_size_t dummy;
+
+            if ((result = _mpd_fntmul(a, b, la, lb, &dummy)) == NULL) {
+                return 0;
+            }
+            memcpy(c, result, (la+lb) * (sizeof *result));
+            mpd_free(result);
+        }
+        return 1;
+    }
+
+    m = (la+1)/2;  /* ceil(la/2) */
+
+    /* lb <= m < la */
+    if (lb <= m) {
 
         /* lb can now be larger than la-m */
         if (lb > la-m) {
@@ -6098,9 +7379,12 @@ _mpd_qmul(mpd_t *result, const mpd_t *a, const mpd_t *b,
             }
         }
     }
-    else if (rsize <= 1024) {
+    else if (rsize <= MPD_KARATSUBA_CUTOFF) {
         rdata = _mpd_kmul(big->data, small->data, big->len, small->len, &rsize);
     }
+    else if ((mpd_size_t)small->len <= _mpd_toom_cutoff()) {
+        rdata = _mpd_tmul(big->data, small->data, big->len, small->len, &rsize);
+    }
     else if (rsize <= 3*MPD_MAXTRANSFORM_2N) {
         rdata = _mpd_fntmul(big->data, small->data, big->len, small->len, &rsize);
     }
@@ -6130,15 +7414,263 @@ finish:
     mpd_setdigits(result);
 }
 
+/*
+ * Short product for operands that are much longer than the precision.
+ * a and b are cut to their t most significant words, t being the words
+ * of the precision plus MPD_MULSHORT_GUARD. With a = ah*B**sa + al and
+ * b = bh*B**sb + bl, the truncated product lo = ah*bh*B**(sa+sb) misses
+ *
+ *     ah*bl*B**sa + al*bh*B**sb + al*bl < (ah + bh + 1) * B**(sa+sb)
+ *                                       <= 10**(max(digits) + 1) * B**(sa+sb),
+ *
+ * so the magnitude of the exact product is in [lo, hi), hi = lo + that
+ * bound. Rounding is monotonic: if lo and hi round to the same result R
+ * with the same status, and R is outside [lo, hi], R is the correctly
+ * rounded product and it is inexact. Otherwise return 0 and let the
+ * caller compute the exact product.
+ */
+#define MPD_MULSHORT_GUARD 2
+
+static int
+_mpd_qmul_short(mpd_t *result, const mpd_t *a, const mpd_t *b,
+                const mpd_context_t *ctx, uint32_t *status)
+{
+    MPD_NEW_STATIC(lo,0,0,0,0);
+    MPD_NEW_STATIC(hi,0,0,0,0);
+    MPD_NEW_STATIC(r,0,0,0,0);
+    MPD_NEW_CONST(eps,0,0,1,1,1,1);
+    mpd_context_t maxctx;
+    mpd_t ah, bh;
+    mpd_ssize_t t, sa, sb;
+    uint32_t rstatus = 0, histatus = 0, workstatus = 0;
+    int ret = 0;
+
+    if (mpd_isspecial(a) || mpd_isspecial(b)) {
+        return 0;
+    }
+
+    t = ctx->prec / MPD_RDIGITS + 1 + MPD_MULSHORT_GUARD;
+    sa = (a->len > t) ? a->len - t : 0;
+    sb = (b->len > t) ? b->len - t : 0;
+
+    /* Not worth it unless at least a third of the words are dropped. */
+    if (2 * (sa + sb) < (a->len - sa) + (b->len - sb)) {
+        return 0;
+    }
+
+    _mpd_copy_shared(&ah, a);
+    ah.data += sa;
+    ah.len -= sa;
+    ah.alloc = ah.len;
+    ah.exp += sa * MPD_RDIGITS;
+    ah.digits -= sa * MPD_RDIGITS;
+
+    _mpd_copy_shared(&bh, b);
+    bh.data += sb;
+    bh.len -= sb;
+    bh.alloc = bh.len;
+    bh.exp += sb * MPD_RDIGITS;
+    bh.digits -= sb * MPD_RDIGITS;
+
+    _mpd_qmul(&lo, &ah, &bh, ctx, &workstatus);
+    if (workstatus & MPD_Malloc_error) {
+        goto finish;
+    }
+
+    mpd_maxcontext(&maxctx);
+    mpd_set_sign(&eps, mpd_sign(&lo));
+    eps.exp = ah.exp + bh.exp + (ah.digits > bh.digits ? ah.digits : bh.digits) + 1;
+    _mpd_qaddsub(&hi, &lo, &eps, mpd_sign(&lo), &maxctx, &workstatus);
+    if (workstatus & MPD_Malloc_error) {
+        goto finish;
+    }
+
+    /* R = round(lo) */
+    if (!mpd_qcopy(&r, &lo, &workstatus)) {
+        goto finish;
+    }
+    mpd_qfinalize(&r, ctx, &rstatus);
+    if (mpd_isspecial(&r) || (rstatus & MPD_Malloc_error)) {
+        goto finish;
+    }
+    if (_mpd_cmp_abs(&r, &lo) >= 0 && _mpd_cmp_abs(&r, &hi) < 0) {
+        goto finish;
+    }
+
+    /* round(hi) must be the same */
+    mpd_qfinalize(&hi, ctx, &histatus);
+    if (rstatus != histatus || mpd_cmp_total(&r, &hi) != 0) {
+        goto finish;
+    }
+
+    if (mpd_qcopy(result, &r, status)) {
+        *status |= rstatus;
+    }
+    else {
+        mpd_seterror(result, MPD_Malloc_error, status);
+    }
+    ret = 1;
+
+finish:
+    mpd_del(&lo);
+    mpd_del(&hi);
+    mpd_del(&r);
+    return ret;
+}
+
 /* Multiply a and b. */
 void
 mpd_qmul(mpd_t *result, const mpd_t *a, const mpd_t *b,
          const mpd_context_t *ctx, uint32_t *status)
 {
+    if (_mpd_qmul_short(result, a, b, ctx, status)) {
+        return;
+    }
+
     _mpd_qmul(result, a, b, ctx, status);
     mpd_qfinalize(result, ctx, status);
 }
 
+/*
+ * Create a plan for multiplying v by operands with up to 'maxdigits' digits.
+ * The plan holds the forward transforms of v for all three moduli, so each
+ * product needs one forward and one inverse transform per modulus instead
+ * of two forward transforms and one inverse transform. If v is special or
+ * too small for the transform multiplication, the plan only keeps a copy
+ * of v.
+ *
+ * Returns NULL and sets MPD_Malloc_error in case of failure.
+ */
+mpd_mulplan_t *
+mpd_qnew_mulplan(const mpd_t *v, mpd_ssize_t maxdigits, uint32_t *status)
+{
+    mpd_mulplan_t *plan;
+    mpd_size_t ulen, rsize, n;
+#ifdef PPRO
+    unsigned int cw;
+#endif
+    int i, ok;
+
+    plan = mpd_alloc(1, sizeof *plan);
+    if (plan == NULL) {
+        *status |= MPD_Malloc_error;
+        return NULL;
+    }
+    plan->n = 0;
+    plan->t[P1] = plan->t[P2] = plan->t[P3] = NULL;
+
+    if ((plan->v = mpd_qncopy(v)) == NULL) {
+        mpd_free(plan);
+        *status |= MPD_Malloc_error;
+        return NULL;
+    }
+
+    if (mpd_isspecial(v) || maxdigits <= 0) {
+        return plan;
+    }
+
+    /* Only products that _mpd_qmul() computes with the FNT benefit. */
+    ulen = (mpd_size_t)(maxdigits / MPD_RDIGITS) + 1;
+    if (ulen <= 256 || v->len <= 256 || ulen > 3*MPD_MAXTRANSFORM_2N) {
+        return plan;
+    }
+    rsize = add_size_t(ulen, v->len);
+    if (rsize <= MPD_KARATSUBA_CUTOFF || rsize > 3*MPD_MAXTRANSFORM_2N) {
+        return plan;
+    }
+    if ((n = _mpd_get_transform_len(rsize)) == MPD_SIZE_MAX) {
+        return plan; /* GCOV_NOT_REACHED */
+    }
+
+    for (i = P1; i <= P3; i++) {
+        if ((plan->t[i] = mpd_calloc(n, sizeof *plan->t[i])) == NULL) {
+            goto malloc_error;
+        }
+        memcpy(plan->t[i], v->data, v->len * (sizeof *plan->t[i]));
+    }
+
+#ifdef PPRO
+    cw = mpd_set_fenv();
+#endif
+    ok = fnt_forward(plan->t[P1], n, P1) &&
+         fnt_forward(plan->t[P2], n, P2) &&
+         fnt_forward(plan->t[P3], n, P3);
+#ifdef PPRO
+    mpd_restore_fenv(cw);
+#endif
+    if (!ok) {
+        goto malloc_error;
+    }
+
+    plan->n = n;
+    return plan;
+
+malloc_error:
+    mpd_del_mulplan(plan);
+    *status |= MPD_Malloc_error;
+    return NULL;
+}
+
+void
+mpd_del_mulplan(mpd_mulplan_t *plan)
+{
+    int i;
+
+    for (i = P1; i <= P3; i++) {
+        if (plan->t[i]) mpd_free(plan->t[i]);
+    }
+    mpd_del(plan->v);
+    mpd_free(plan);
+}
+
+/* Multiply a by the operand of the plan. Products that do not fit the
+   stored transforms, or that _mpd_qmul() would not compute with the
+   transform, are computed by mpd_qmul(). */
+void
+mpd_qmul_plan(mpd_t *result, const mpd_t *a, const mpd_mulplan_t *plan,
+              const mpd_context_t *ctx, uint32_t *status)
+{
+    const mpd_t *v = plan->v;
+    mpd_uint_t *rdata;
+    mpd_size_t rsize;
+    uint8_t sign;
+    mpd_ssize_t exp;
+
+    if (plan->n == 0 || mpd_isspecial(a) || a->len <= 256 ||
+        (mpd_size_t)(a->len + v->len) <= MPD_KARATSUBA_CUTOFF ||
+        (mpd_size_t)a->len <= _mpd_toom_cutoff() ||
+        (mpd_size_t)v->len <= _mpd_toom_cutoff() ||
+        (mpd_size_t)(a->len + v->len) > plan->n) {
+        mpd_qmul(result, a, v, ctx, status);
+        return;
+    }
+
+    sign = mpd_sign(a) ^ mpd_sign(v);
+    exp = a->exp + v->exp;
+
+    rdata = _mpd_fntmul_plan(a->data, a->len, plan, &rsize);
+    if (rdata == NULL) {
+        mpd_seterror(result, MPD_Malloc_error, status);
+        return;
+    }
+
+    if (mpd_isdynamic_data(result)) {
+        mpd_free(result->data);
+    }
+    result->data = rdata;
+    result->alloc = rsize;
+    mpd_set_dynamic_data(result);
+
+    mpd_set_flags(result, sign);
+    result->exp = exp;
+    result->len = _mpd_real_size(result->data, rsize);
+    /* resize to smaller cannot fail */
+    mpd_qresize(result, result->len, status);
+    mpd_setdigits(result);
+
+    mpd_qfinalize(result, ctx, status);
+}
+
 /* Multiply a and b. Set NaN/Invalid_operation if the result is inexact. */
 static void
 _mpd_qmul_exact(mpd_t *result, const mpd_t *a, const mpd_t *b,
@@ -6414,11 +7946,32 @@ mpd_qnext_toward(mpd_t *result, const mpd_t *a, const mpd_t *b,
 }
 
 /*
- * Internal function: Integer power with mpd_uint_t exponent. The function
- * can fail with MPD_Malloc_error.
+ * Window size for _mpd_qpow_uint(). A window of w bits needs a table of
+ * 2**(w-1) odd powers, which costs 2**(w-1) multiplications. The main loop
+ * then needs about nbits/(w+1) multiplications instead of nbits/2.
+ */
+static inline int
+_mpd_qpow_window(int nbits)
+{
+    if (nbits <= 9) {
+        return 1;
+    }
+    if (nbits <= 25) {
+        return 2;
+    }
+    return 3;
+}
+
+/*
+ * Internal function: Integer power with mpd_uint_t exponent. The power is
+ * computed by left-to-right sliding window exponentiation with a table of
+ * the odd powers x, x**3, ..., x**(2**w-1). The function can fail with
+ * MPD_Malloc_error.
  *
- * The error is equal to the error incurred in k-1 multiplications. Assuming
- * the upper bound for the relative error in each operation:
+ * Each step of the addition chain multiplies two earlier results. By
+ * induction, the error in x**j is that of j-1 multiplications, so the
+ * error in the result is equal to the error incurred in k-1 multiplications.
+ * Assuming the upper bound for the relative error in each operation:
  *
  *   abs(err) = 5 * 10**-prec
  *   result = x**k * (1 + err)**(k-1)
@@ -6428,22 +7981,65 @@ _mpd_qpow_uint(mpd_t *result, const mpd_t *base, mpd_uint_t exp,
                uint8_t resultsign, const mpd_context_t *ctx, uint32_t *status)
 {
     uint32_t workstatus = 0;
+    MPD_NEW_STATIC(x2,0,0,0,0);
+    MPD_NEW_STATIC(x3,0,0,0,0);
+    MPD_NEW_STATIC(x5,0,0,0,0);
+    MPD_NEW_STATIC(x7,0,0,0,0);
+    mpd_t *tab[4] = {NULL, &x3, &x5, &x7};
+    const mpd_t *last;
     mpd_uint_t n;
+    int i, j, w;
 
     if (exp == 0) {
         _settriple(result, resultsign, 1, 0); /* GCOV_NOT_REACHED */
         return; /* GCOV_NOT_REACHED */
     }
 
-    if (!mpd_qcopy(result, base, status)) {
-        return;
+    i = mpd_bsr(exp);
+    w = _mpd_qpow_window(i+1);
+
+    /* odd powers: tab[m] = x**(2*m+1) */
+    if (w > 1) {
+        mpd_qmul(&x2, base, base, ctx, &workstatus);
+        mpd_qmul(tab[1], base, &x2, ctx, &workstatus);
+        for (j = 2; j < (1<<(w-1)); j++) {
+            mpd_qmul(tab[j], tab[j-1], &x2, ctx, &workstatus);
+        }
+        last = tab[j-1];
+        if (mpd_isspecial(last) ||
+            (mpd_iszerocoeff(last) && (workstatus & MPD_Clamped))) {
+            /* x**k for k >= 2**w-1 has the same fate */
+            mpd_qcopy(result, last, &workstatus);
+            goto finish;
+        }
+    }
+
+    /* the leading window */
+    j = (i >= w-1) ? i-w+1 : 0;
+    while (!(exp & mpd_bits[j])) {
+        j++;
+    }
+    n = (exp >> j) & (mpd_bits[i-j+1]-1);
+    if (!mpd_qcopy(result, (n == 1) ? base : tab[n>>1], status)) {
+        goto finish;
     }
 
-    n = mpd_bits[mpd_bsr(exp)];
-    while (n >>= 1) {
-        mpd_qmul(result, result, result, ctx, &workstatus);
-        if (exp & n) {
-            mpd_qmul(result, result, base, ctx, &workstatus);
+    for (i = j-1; i >= 0; i = j-1) {
+        if (!(exp & mpd_bits[i])) {
+            mpd_qmul(result, result, result, ctx, &workstatus);
+            j = i;
+        }
+        else {
+            j = (i >= w-1) ? i-w+1 : 0;
+            while (!(exp & mpd_bits[j])) {
+                j++;
+            }
+            n = (exp >> j) & (mpd_bits[i-j+1]-1);
+            for (; i >= j; i--) {
+                mpd_qmul(result, result, result, ctx, &workstatus);
+            }
+            mpd_qmul(result, result, (n == 1) ? base : tab[n>>1], ctx,
+                     &workstatus);
         }
         if (mpd_isspecial(result) ||
             (mpd_iszerocoeff(result) && (workstatus & MPD_Clamped))) {
@@ -6451,6 +8047,11 @@ _mpd_qpow_uint(mpd_t *result, const mpd_t *base, mpd_uint_t exp,
         }
     }
 
+finish:
+    mpd_del(&x2);
+    mpd_del(&x3);
+    mpd_del(&x5);
+    mpd_del(&x7);
     *status |= workstatus;
     mpd_set_sign(result, resultsign);
 }
@@ -6942,62 +8543,532 @@ mpd_qpow(mpd_t *result, const mpd_t *base, const mpd_t *exp,
 }
 
 /*
- * Internal function: Integer powmod with mpd_uint_t exponent, base is modified!
- * Function can fail with MPD_Malloc_error.
+ * Modular multiplication for mpd_qpowmod(). The modulus m is a positive
+ * integer with exponent 0. A modulus of one word is handled with word
+ * arithmetic, longer moduli with Barrett reduction [HAC 14.42] in base
+ * B = MPD_RADIX: with k the length of m and mu = floor(B**(2k) / m), the
+ * quotient of x < m**2 and m is estimated as
+ *
+ *   q = floor(floor(x / B**(k-1)) * mu / B**(k+1)),
+ *
+ * which is at most two less than the true quotient. mu is computed once
+ * per modulus, after which a reduction costs two multiplications and a
+ * few subtractions instead of a division.
+ *
+ * Up to MPD_POWMOD_COMBA_MAX words, the products are computed column by
+ * column [Comba], with a single division by MPD_RADIX per column. Only
+ * the columns from k-1 of the first product and the columns up to k of
+ * q*m are computed. Omitting the lower columns of the first product
+ * lowers q by at most one more, and x - q*m < 4*m < B**(k+1) is found
+ * from the low k+1 words of x and q*m.
  */
+#define MPD_POWMOD_COMBA_MAX 512
+
+struct _mpd_powmod {
+    const mpd_t *m;         /* modulus */
+    mpd_t *mu;              /* floor(B**(2k) / m), unused if k == 1 */
+    mpd_t *t;               /* unreduced product */
+    mpd_t *q;               /* quotient estimate */
+    mpd_uint_t *w;          /* word buffers for the Comba products */
+    mpd_ssize_t k;          /* length of m */
+    mpd_context_t ctx;      /* maxcontext */
+};
+
+/* Add u*v to the three word accumulator a. */
 static inline void
-_mpd_qpowmod_uint(mpd_t *result, mpd_t *base, mpd_uint_t exp,
-                  const mpd_t *mod, uint32_t *status)
+_mpd_comba_addmul(mpd_uint_t a[3], mpd_uint_t u, mpd_uint_t v)
 {
-    mpd_context_t maxcontext;
+    mpd_uint_t hi, lo;
 
-    mpd_maxcontext(&maxcontext);
+    _mpd_mul_words(&hi, &lo, u, v);
+    a[0] += lo;
+    if (a[0] < lo) hi++;
+    a[1] += hi;
+    if (a[1] < hi) a[2]++;
+}
 
-    /* resize to smaller cannot fail */
-    mpd_qcopy(result, &one, status);
+/* Store a % MPD_RADIX in *w, set a to a / MPD_RADIX. */
+static inline void
+_mpd_comba_digit(mpd_uint_t a[3], mpd_uint_t *w)
+{
+    mpd_uint_t q1, r1;
 
-    while (exp > 0) {
-        if (exp & 1) {
-            _mpd_qmul_exact(result, result, base, &maxcontext, status);
-            mpd_qrem(result, result, mod, &maxcontext, status);
+    _mpd_div_words_r(&q1, &r1, a[2], a[1]);
+    _mpd_div_words_r(&a[0], w, r1, a[0]);
+    a[1] = q1;
+    a[2] = 0;
+}
+
+/* w := u * v, for u and v of n words. w has 2*n words. */
+static void
+_mpd_comba_mul(mpd_uint_t *w, const mpd_uint_t *u, const mpd_uint_t *v,
+               mpd_size_t n)
+{
+    mpd_uint_t a[3] = {0,0,0};
+    mpd_size_t c, i, lo, hi;
+
+    for (c = 0; c < 2*n-1; c++) {
+        lo = (c < n) ? 0 : c-n+1;
+        hi = (c < n) ? c : n-1;
+        for (i = lo; i <= hi; i++) {
+            _mpd_comba_addmul(a, u[i], v[c-i]);
         }
-        _mpd_qmul_exact(base, base, base, &maxcontext, status);
-        mpd_qrem(base, base, mod, &maxcontext, status);
-        exp >>= 1;
+        _mpd_comba_digit(a, &w[c]);
     }
+    w[2*n-1] = a[0];
 }
 
-/* The powmod function: (base**exp) % mod */
-void
-mpd_qpowmod(mpd_t *result, const mpd_t *base, const mpd_t *exp,
-            const mpd_t *mod,
-            const mpd_context_t *ctx, uint32_t *status)
+/* w := u * u, for u of n words. w has 2*n words. */
+static void
+_mpd_comba_sqr(mpd_uint_t *w, const mpd_uint_t *u, mpd_size_t n)
 {
-    mpd_context_t maxcontext;
-    MPD_NEW_STATIC(tbase,0,0,0,0);
-    MPD_NEW_STATIC(texp,0,0,0,0);
-    MPD_NEW_STATIC(tmod,0,0,0,0);
-    MPD_NEW_STATIC(tmp,0,0,0,0);
-    MPD_NEW_CONST(two,0,0,1,1,1,2);
-    mpd_ssize_t tbase_exp, texp_exp;
-    mpd_ssize_t i;
-    mpd_t t;
-    mpd_uint_t r;
-    uint8_t sign;
+    mpd_uint_t a[3] = {0,0,0};
+    mpd_uint_t s[3];
+    mpd_size_t c, i, lo, hi;
 
+    for (c = 0; c < 2*n-1; c++) {
+        lo = (c < n) ? 0 : c-n+1;
+        hi = (c < n) ? c : n-1;
 
-    if (mpd_isspecial(base) || mpd_isspecial(exp) || mpd_isspecial(mod)) {
-        if (mpd_qcheck_3nans(result, base, exp, mod, ctx, status)) {
-            return;
+        /* s = sum of u[i]*u[c-i] for i < c-i */
+        s[0] = s[1] = s[2] = 0;
+        for (i = lo; i < c-i && i <= hi; i++) {
+            _mpd_comba_addmul(s, u[i], u[c-i]);
         }
-        mpd_seterror(result, MPD_Invalid_operation, status);
-        return;
-    }
 
+        /* a += 2*s */
+        s[2] = (s[2] << 1) | (s[1] >> (MPD_BITS_PER_UINT-1));
+        s[1] = (s[1] << 1) | (s[0] >> (MPD_BITS_PER_UINT-1));
+        s[0] = s[0] << 1;
+        a[0] += s[0];
+        if (a[0] < s[0]) { if (++a[1] == 0) a[2]++; }
+        a[1] += s[1];
+        if (a[1] < s[1]) a[2]++;
+        a[2] += s[2];
 
-    if (!_mpd_isint(base) || !_mpd_isint(exp) || !_mpd_isint(mod)) {
-        mpd_seterror(result, MPD_Invalid_operation, status);
-        return;
+        if (c % 2 == 0) {
+            _mpd_comba_addmul(a, u[c/2], u[c/2]);
+        }
+        _mpd_comba_digit(a, &w[c]);
+    }
+    w[2*n-1] = a[0];
+}
+
+/*
+ * Reduce x < m**2 of 2*k words modulo m, with the Comba products. The
+ * result is stored in r, which has k+1 words. q has k+1 words.
+ */
+static void
+_mpd_comba_reduce(mpd_uint_t *r, const mpd_uint_t *x, mpd_uint_t *q,
+                  const mpd_uint_t *m, const mpd_uint_t *mu, mpd_size_t k)
+{
+    const mpd_uint_t *q1 = x + (k-1);
+    mpd_uint_t a[3] = {0,0,0};
+    mpd_uint_t d, borrow;
+    mpd_size_t c, i, lo, hi;
+
+    /* q = floor(q1 * mu / B**(k+1)), q1 and mu have k+1 words */
+    for (c = k-1; c < 2*k+1; c++) {
+        lo = (c <= k) ? 0 : c-k;
+        hi = (c <= k) ? c : k;
+        for (i = lo; i <= hi; i++) {
+            _mpd_comba_addmul(a, q1[i], mu[c-i]);
+        }
+        if (c <= k) {
+            _mpd_comba_digit(a, &d);
+        }
+        else {
+            _mpd_comba_digit(a, &q[c-k-1]);
+        }
+    }
+    q[k] = a[0];
+
+    /* r = (x - q*m) % B**(k+1), m has k words */
+    a[0] = a[1] = a[2] = 0;
+    borrow = 0;
+    for (c = 0; c <= k; c++) {
+        hi = (c < k) ? c : k-1;
+        for (i = 0; i <= hi; i++) {
+            _mpd_comba_addmul(a, q[c-i], m[i]);
+        }
+        _mpd_comba_digit(a, &d);
+
+        d += borrow;
+        if (x[c] < d) {
+            r[c] = x[c] + (MPD_RADIX - d);
+            borrow = 1;
+        }
+        else {
+            r[c] = x[c] - d;
+            borrow = 0;
+        }
+    }
+
+    /* r < 4*m */
+    for (;;) {
+        if (r[k] == 0) {
+            for (i = k-1; i != MPD_SIZE_MAX && r[i] == m[i]; i--)
+                ;
+            if (i != MPD_SIZE_MAX && r[i] < m[i]) {
+                break;
+            }
+            if (i == MPD_SIZE_MAX) {
+                mpd_uint_zero(r, k);
+                break;
+            }
+        }
+        /* r has k+1 words, the borrow stops at r[k] */
+        _mpd_basesubfrom(r, m, k);
+    }
+}
+
+/* Initialize pm for the modulus m. Return 0 on malloc error. */
+static int
+_mpd_powmod_init(struct _mpd_powmod *pm, const mpd_t *m, mpd_t *mu,
+                 mpd_t *t, mpd_t *q, uint32_t *status)
+{
+    mpd_ssize_t k = m->len;
+
+    pm->m = m;
+    pm->mu = mu;
+    pm->t = t;
+    pm->q = q;
+    pm->w = NULL;
+    pm->k = k;
+    mpd_maxcontext(&pm->ctx);
+
+    if (k == 1) {
+        return 1;
+    }
+
+    if (!mpd_qshiftl(t, &one, 2*k*MPD_RDIGITS, status)) {
+        return 0;
+    }
+    mpd_qdivint(mu, t, m, &pm->ctx, status);
+    if (mpd_isspecial(mu)) {
+        return 0;
+    }
+
+    /* mu has k+2 words if m is a power of B */
+    if (k <= MPD_POWMOD_COMBA_MAX && mu->len == k+1) {
+        /* m, mu, two operands, product, quotient, remainder */
+        if ((pm->w = mpd_calloc(8*k+3, sizeof *pm->w)) == NULL) {
+            *status |= MPD_Malloc_error;
+            return 0;
+        }
+        memcpy(pm->w, m->data, k * (sizeof *pm->w));
+        memcpy(pm->w+k, mu->data, (k+1) * (sizeof *pm->w));
+    }
+
+    return 1;
+}
+
+static void
+_mpd_powmod_del(struct _mpd_powmod *pm)
+{
+    if (pm->w) mpd_free(pm->w);
+}
+
+/* Copy the integer a < B**k to u, padded with zeros to k words. */
+static inline void
+_mpd_powmod_load(mpd_uint_t *u, const mpd_t *a, mpd_ssize_t k)
+{
+    memcpy(u, a->data, a->len * (sizeof *u));
+    mpd_uint_zero(u+a->len, k-a->len);
+}
+
+/* Set r to a * b % m with the Comba products. */
+static int
+_mpd_powmod_comba(mpd_t *r, const mpd_t *a, const mpd_t *b,
+                  struct _mpd_powmod *pm, uint32_t *status)
+{
+    mpd_ssize_t k = pm->k;
+    mpd_uint_t *m = pm->w;
+    mpd_uint_t *mu = m + k;
+    mpd_uint_t *u = mu + (k+1);
+    mpd_uint_t *v = u + k;
+    mpd_uint_t *x = v + k;
+    mpd_uint_t *q = x + 2*k;
+    mpd_uint_t *rw = q + (k+1);
+
+    _mpd_powmod_load(u, a, k);
+    if (a == b) {
+        _mpd_comba_sqr(x, u, k);
+    }
+    else {
+        _mpd_powmod_load(v, b, k);
+        _mpd_comba_mul(x, u, v, k);
+    }
+
+    _mpd_comba_reduce(rw, x, q, m, mu, k);
+    assert(rw[k] == 0);
+
+    if (!mpd_qresize(r, k, status)) {
+        return 0;
+    }
+    memcpy(r->data, rw, k * (sizeof *rw));
+    mpd_set_flags(r, MPD_POS);
+    r->exp = 0;
+    r->len = _mpd_real_size(r->data, k);
+    mpd_setdigits(r);
+
+    return 1;
+}
+
+/* Set r to an integer x in pm->t with x < m**2, reduced modulo m. */
+static int
+_mpd_powmod_reduce(mpd_t *r, struct _mpd_powmod *pm, uint32_t *status)
+{
+    const mpd_t *m = pm->m;
+    mpd_ssize_t k = pm->k;
+    mpd_t v;
+
+    if (_mpd_cmp_abs(pm->t, m) < 0) {
+        return mpd_qcopy(r, pm->t, status);
+    }
+
+    /* q = floor(x / B**(k-1)) * mu */
+    _mpd_copy_shared(&v, pm->t);
+    v.data += k-1;
+    v.len -= k-1;
+    v.alloc = v.len;
+    v.digits -= (k-1) * MPD_RDIGITS;
+    _mpd_qmul(pm->q, &v, pm->mu, &pm->ctx, status);
+    if (mpd_isspecial(pm->q)) {
+        return 0;
+    }
+
+    /* r = x - floor(q / B**(k+1)) * m */
+    if (pm->q->len > k+1) {
+        _mpd_copy_shared(&v, pm->q);
+        v.data += k+1;
+        v.len -= k+1;
+        v.alloc = v.len;
+        v.digits -= (k+1) * MPD_RDIGITS;
+        _mpd_qmul(r, &v, m, &pm->ctx, status);
+        if (mpd_isspecial(r)) {
+            return 0;
+        }
+        _mpd_qaddsub(r, pm->t, r, MPD_NEG, &pm->ctx, status);
+    }
+    else {
+        if (!mpd_qcopy(r, pm->t, status)) {
+            return 0;
+        }
+    }
+
+    while (!mpd_isspecial(r) && _mpd_cmp_abs(r, m) >= 0) {
+        _mpd_qaddsub(r, r, m, MPD_NEG, &pm->ctx, status);
+    }
+
+    return !mpd_isspecial(r);
+}
+
+/* r = a * b % m, for integers 0 <= a, b < m. Return 0 on malloc error. */
+static int
+_mpd_powmod_mul(mpd_t *r, const mpd_t *a, const mpd_t *b,
+                struct _mpd_powmod *pm, uint32_t *status)
+{
+    mpd_uint_t hi, lo, q;
+
+    if (pm->k == 1) {
+        _mpd_mul_words(&hi, &lo, a->data[0], b->data[0]);
+        _mpd_div_words(&q, &lo, hi, lo, pm->m->data[0]);
+        _settriple(r, MPD_POS, lo, 0);
+        return 1;
+    }
+    if (pm->w != NULL) {
+        return _mpd_powmod_comba(r, a, b, pm, status);
+    }
+
+    _mpd_qmul(pm->t, a, b, &pm->ctx, status);
+    if (mpd_isspecial(pm->t)) {
+        return 0;
+    }
+
+    return _mpd_powmod_reduce(r, pm, status);
+}
+
+#ifdef CONFIG_64
+  #define MPD_EXPBITS 62
+#else
+  #define MPD_EXPBITS 29
+#endif
+#define MPD_POWMOD_MAXWINDOW 6
+
+/*
+ * Convert the coefficient of e != 0 to base 2**MPD_EXPBITS, least
+ * significant word first, and store the number of bits in nbits.
+ * Return NULL on malloc error.
+ */
+static mpd_uint_t *
+_mpd_exp_to_binary(const mpd_t *e, mpd_size_t *nbits)
+{
+    struct word_inverse inv;
+    mpd_uint_t *u, *w;
+    mpd_size_t n = e->len;
+    mpd_size_t len = 0;
+
+    if ((u = mpd_alloc(n, sizeof *u)) == NULL) {
+        return NULL;
+    }
+    /* each word of e has fewer than 2*MPD_EXPBITS bits */
+    if ((w = mpd_alloc(2*n, sizeof *w)) == NULL) {
+        mpd_free(u);
+        return NULL;
+    }
+
+    memcpy(u, e->data, n * (sizeof *u));
+    _mpd_init_word_inverse(&inv, (mpd_uint_t)1<<MPD_EXPBITS);
+    while (n > 0) {
+        w[len++] = _mpd_shortdiv_inv(u, u, n, &inv);
+        while (n > 0 && u[n-1] == 0) {
+            n--;
+        }
+    }
+
+    *nbits = (len-1) * MPD_EXPBITS + mpd_bsr(w[len-1]) + 1;
+    mpd_free(u);
+    return w;
+}
+
+static inline int
+_mpd_expbit(const mpd_uint_t *e, mpd_size_t i)
+{
+    return (e[i/MPD_EXPBITS] >> (i%MPD_EXPBITS)) & 1;
+}
+
+/*
+ * result = base**e % m, for an integer 0 <= base < m and the exponent e
+ * with nbits > 0 bits from _mpd_exp_to_binary(). Left-to-right sliding
+ * window exponentiation [HAC 14.85]: the odd powers of base up to the
+ * window size are precomputed, and each window of the exponent costs one
+ * multiplication. result and base must not be the same. Return 0 on
+ * malloc error.
+ */
+static int
+_mpd_powmod_pow(mpd_t *result, const mpd_t *base, const mpd_uint_t *e,
+                mpd_size_t nbits, struct _mpd_powmod *pm, uint32_t *status)
+{
+    mpd_t *tab[1<<(MPD_POWMOD_MAXWINDOW-1)];
+    mpd_size_t i, j, l, val;
+    int w, ntab, started = 0;
+    int ok = 0;
+
+    w = (nbits <= 8) ? 1 : (nbits <= 24) ? 2 : (nbits <= 80) ? 3 :
+        (nbits <= 240) ? 4 : (nbits <= 672) ? 5 : MPD_POWMOD_MAXWINDOW;
+    ntab = 1 << (w-1);
+
+    for (i = 0; i < (mpd_size_t)ntab; i++) {
+        tab[i] = NULL;
+    }
+
+    /* tab[i] = base**(2*i+1) */
+    for (i = 0; i < (mpd_size_t)ntab; i++) {
+        if ((tab[i] = mpd_qnew()) == NULL) {
+            *status |= MPD_Malloc_error;
+            goto finish;
+        }
+    }
+    if (!mpd_qcopy(tab[0], base, status)) {
+        goto finish;
+    }
+    if (ntab > 1) {
+        if (!_mpd_powmod_mul(result, base, base, pm, status)) {
+            goto finish;
+        }
+        for (i = 1; i < (mpd_size_t)ntab; i++) {
+            if (!_mpd_powmod_mul(tab[i], tab[i-1], result, pm, status)) {
+                goto finish;
+            }
+        }
+    }
+
+    i = nbits;
+    while (i > 0) {
+        if (!_mpd_expbit(e, i-1)) {
+            if (!_mpd_powmod_mul(result, result, result, pm, status)) {
+                goto finish;
+            }
+            i--;
+            continue;
+        }
+
+        /* longest window e[j..i-1] with w bits at most and e[j] == 1 */
+        j = (i > (mpd_size_t)w) ? i-w : 0;
+        while (!_mpd_expbit(e, j)) {
+            j++;
+        }
+        for (val = 0, l = i; l > j; l--) {
+            val = 2*val + _mpd_expbit(e, l-1);
+        }
+
+        if (started) {
+            for (l = j; l < i; l++) {
+                if (!_mpd_powmod_mul(result, result, result, pm, status)) {
+                    goto finish;
+                }
+            }
+            if (!_mpd_powmod_mul(result, result, tab[val/2], pm, status)) {
+                goto finish;
+            }
+        }
+        else {
+            if (!mpd_qcopy(result, tab[val/2], status)) {
+                goto finish;
+            }
+            started = 1;
+        }
+        i = j;
+    }
+
+    ok = 1;
+
+finish:
+    for (i = 0; i < (mpd_size_t)ntab; i++) {
+        if (tab[i]) mpd_del(tab[i]);
+    }
+    return ok;
+}
+
+/* The powmod function: (base**exp) % mod */
+void
+mpd_qpowmod(mpd_t *result, const mpd_t *base, const mpd_t *exp,
+            const mpd_t *mod,
+            const mpd_context_t *ctx, uint32_t *status)
+{
+    mpd_context_t maxcontext;
+    MPD_NEW_STATIC(tbase,0,0,0,0);
+    MPD_NEW_STATIC(texp,0,0,0,0);
+    MPD_NEW_STATIC(tmod,0,0,0,0);
+    MPD_NEW_STATIC(tmp,0,0,0,0);
+    MPD_NEW_STATIC(mu,0,0,0,0);
+    MPD_NEW_STATIC(t1,0,0,0,0);
+    MPD_NEW_STATIC(t2,0,0,0,0);
+    const mpd_uint_t ten = 10;
+    struct _mpd_powmod pm;
+    mpd_uint_t *ebits;
+    mpd_size_t nbits;
+    mpd_ssize_t tbase_exp, texp_exp;
+    mpd_ssize_t i;
+    mpd_t t;
+    mpd_uint_t r;
+    uint8_t sign;
+    int ok;
+
+
+    if (mpd_isspecial(base) || mpd_isspecial(exp) || mpd_isspecial(mod)) {
+        if (mpd_qcheck_3nans(result, base, exp, mod, ctx, status)) {
+            return;
+        }
+        mpd_seterror(result, MPD_Invalid_operation, status);
+        return;
+    }
+
+
+    if (!_mpd_isint(base) || !_mpd_isint(exp) || !_mpd_isint(mod)) {
+        mpd_seterror(result, MPD_Invalid_operation, status);
+        return;
     }
     if (mpd_iszerocoeff(mod)) {
         mpd_seterror(result, MPD_Invalid_operation, status);
@@ -7028,6 +9099,7 @@ mpd_qpowmod(mpd_t *result, const mpd_t *base, const mpd_t *exp,
     }
 
     mpd_maxcontext(&maxcontext);
+    pm.w = NULL;
 
     mpd_qrescale(&tmod, mod, 0, &maxcontext, &maxcontext.status);
     if (maxcontext.status&MPD_Errors) {
@@ -7058,41 +9130,40 @@ mpd_qpowmod(mpd_t *result, const mpd_t *base, const mpd_t *exp,
         goto mpd_errors;
     }
 
+    if (!_mpd_powmod_init(&pm, &tmod, &mu, &t1, &t2, status)) {
+        goto mpd_errors;
+    }
+
     for (i = 0; i < texp_exp; i++) {
-        _mpd_qpowmod_uint(&tmp, &tbase, 10, &tmod, status);
+        if (!_mpd_powmod_pow(&tmp, &tbase, &ten, 4, &pm, status)) {
+            goto mpd_errors;
+        }
         t = tmp;
         tmp = tbase;
         tbase = t;
     }
-    if (mpd_isspecial(&tbase)) {
-        goto mpd_errors; /* GCOV_UNLIKELY */
-    }
 
-    /* resize to smaller cannot fail */
-    mpd_qcopy(result, &one, status);
-    while (mpd_isfinite(&texp) && !mpd_iszero(&texp)) {
-        if (mpd_isodd(&texp)) {
-            _mpd_qmul_exact(result, result, &tbase, &maxcontext, status);
-            mpd_qrem(result, result, &tmod, &maxcontext, status);
-        }
-        _mpd_qmul_exact(&tbase, &tbase, &tbase, &maxcontext, status);
-        mpd_qrem(&tbase, &tbase, &tmod, &maxcontext, status);
-        mpd_qdivint(&texp, &texp, &two, &maxcontext, status);
+    if ((ebits = _mpd_exp_to_binary(&texp, &nbits)) == NULL) {
+        *status |= MPD_Malloc_error;
+        goto mpd_errors;
     }
-    if (mpd_isspecial(&texp) || mpd_isspecial(&tbase) ||
-        mpd_isspecial(&tmod) || mpd_isspecial(result)) {
+    ok = _mpd_powmod_pow(result, &tbase, ebits, nbits, &pm, status);
+    mpd_free(ebits);
+    if (!ok) {
         /* MPD_Malloc_error */
         goto mpd_errors;
     }
-    else {
-        mpd_set_sign(result, sign);
-    }
+    mpd_set_sign(result, sign);
 
 out:
     mpd_del(&tbase);
     mpd_del(&texp);
     mpd_del(&tmod);
     mpd_del(&tmp);
+    mpd_del(&mu);
+    mpd_del(&t1);
+    mpd_del(&t2);
+    _mpd_powmod_del(&pm);
     return;
 
 mpd_errors:
@@ -7243,7 +9314,7 @@ mpd_qrem(mpd_t *r, const mpd_t *a, const mpd_t *b, const mpd_context_t *ctx,
         return;
     }
 
-    _mpd_qdivmod(&q, r, a, b, ctx, status);
+    _mpd_qdivmod(&q, r, a, b, NULL, ctx, status);
     mpd_del(&q);
     mpd_qfinalize(r, ctx, status);
 }
@@ -7294,7 +9365,7 @@ mpd_qrem_near(mpd_t *r, const mpd_t *a, const mpd_t *b,
         b = &btmp;
     }
 
-    _mpd_qdivmod(&q, r, a, b, ctx, status);
+    _mpd_qdivmod(&q, r, a, b, NULL, ctx, status);
     if (mpd_isnan(&q) || mpd_isnan(r)) {
         goto finish;
     }
@@ -7678,6 +9749,8 @@ _mpd_qreciprocal(mpd_t *result, const mpd_t *a, const mpd_context_t *ctx,
  *
  * Strategy: Multiply the dividend by the reciprocal of the divisor. The
  * inexact result is fixed by a small loop, using at most one iteration.
+ * If dv is not NULL and holds a reciprocal of sufficient precision, that
+ * reciprocal is used instead of a new one.
  *
  * ACL2 proofs:
  * ------------
@@ -7688,11 +9761,12 @@ _mpd_qreciprocal(mpd_t *result, const mpd_t *a, const mpd_context_t *ctx,
  */
 static void
 _mpd_base_ndivmod(mpd_t *q, mpd_t *r, const mpd_t *a, const mpd_t *b,
-                  uint32_t *status)
+                  const mpd_divisor_t *dv, uint32_t *status)
 {
     mpd_context_t workctx;
     mpd_t *qq = q, *rr = r;
-    mpd_t aa, bb;
+    mpd_t aa, bb, xx;
+    mpd_ssize_t shift;
     int k;
 
     _mpd_copy_shared(&aa, a);
@@ -7725,18 +9799,38 @@ _mpd_base_ndivmod(mpd_t *q, mpd_t *r, const mpd_t *a, const mpd_t *b,
         goto nanresult;
     }
 
-    /* Let x := _mpd_qreciprocal(b, prec)
-     * Then x is bounded by:
-     *    1) 1/b - 10**(-prec - bdigits) < x < 1/b + 10**(-prec - bdigits)
-     *    2) 1/b - 10**(-adigits - 4) < x < 1/b + 10**(-adigits - 4)
-     */
-    _mpd_qreciprocal(rr, &bb, &workctx, &workctx.status);
+    if (_mpd_divisor_hasrecip(dv, a, b)) {
+        /* Let x := the stored reciprocal, truncated to at least prec+3
+         * digits by dropping whole words. The truncation error is less
+         * than 10**(-prec - bdigits - 2), so the bounds 1) to 3) below
+         * hold with an error that is 1.01 times larger. The correction
+         * loop handles this.
+         */
+        _mpd_copy_shared(&xx, dv->x);
+        shift = (xx.digits - (workctx.prec + 3)) / MPD_RDIGITS;
+        if (shift > 0) {
+            xx.data += shift;
+            xx.len -= shift;
+            xx.alloc -= shift;
+            xx.digits -= shift * MPD_RDIGITS;
+            xx.exp += shift * MPD_RDIGITS;
+        }
+        _mpd_qmul(qq, &aa, &xx, &workctx, &workctx.status);
+    }
+    else {
+        /* Let x := _mpd_qreciprocal(b, prec)
+         * Then x is bounded by:
+         *    1) 1/b - 10**(-prec - bdigits) < x < 1/b + 10**(-prec - bdigits)
+         *    2) 1/b - 10**(-adigits - 4) < x < 1/b + 10**(-adigits - 4)
+         */
+        _mpd_qreciprocal(rr, &bb, &workctx, &workctx.status);
 
-    /* Get an estimate for the quotient. Let q := a * x
-     * Then q is bounded by:
-     *    3) a/b - 10**-4 < q < a/b + 10**-4
-     */
-    _mpd_qmul(qq, &aa, rr, &workctx, &workctx.status);
+        /* Get an estimate for the quotient. Let q := a * x
+         * Then q is bounded by:
+         *    3) a/b - 10**-4 < q < a/b + 10**-4
+         */
+        _mpd_qmul(qq, &aa, rr, &workctx, &workctx.status);
+    }
     /* Truncate q to an integer:
      *    4) a/b - 2 < trunc(q) < a/b + 1
      */
@@ -7805,40 +9899,307 @@ nanresult:
     mpd_setspecial(r, MPD_POS, MPD_NAN);
 }
 
-/* LIBMPDEC_ONLY */
 /*
- * Schedule the optimal precision increase for the Newton iteration.
- *   v := input operand
- *   z_0 := initial approximation
- *   initprec := natural number such that abs(sqrt(v) - z_0) < 10**-initprec
- *   maxprec := target precision
+ * Recursive division: C. Burnikel and J. Ziegler, "Fast Recursive Division",
+ * Research Report MPI-I-98-1-022, Max-Planck-Institut fuer Informatik, 1998.
  *
- * For convenience the output klist contains the elements in reverse order:
- *   klist := [k_n-1, ..., k_0], where
- *     1) k_0 <= initprec and
- *     2) abs(sqrt(v) - result) < 10**(-2*k_n-1 + 2) <= 10**-maxprec.
+ * A division of 2n by n words is done as two divisions of 3n/2 by n words.
+ * Each of these divides the upper n words of the dividend by the upper n/2
+ * words of the divisor recursively and corrects the estimate with one
+ * product of n/2 words, which uses Karatsuba, Toom-3 or the transform as
+ * in _mpd_qmul(). The recursion stops at divisors of at most
+ * MPD_BZDIV_CUTOFF words, which are handled by _mpd_basedivmod(). Odd
+ * lengths are split unevenly, so the divisor does not need to be padded.
  */
-static inline int
-invroot_schedule_prec(mpd_ssize_t klist[MPD_MAX_PREC_LOG2],
-                      mpd_ssize_t maxprec, mpd_ssize_t initprec)
-{
-    mpd_ssize_t k;
-    int i;
 
-    assert(maxprec >= 3 && initprec >= 3);
-    if (maxprec <= initprec) return -1;
-
-    i = 0; k = maxprec;
-    do {
-        k = (k+3) / 2;
-        klist[i++] = k;
-    } while (k > initprec);
+/* w := u * v, ulen >= vlen. Return 0 on malloc error. */
+static int
+_bz_mul(mpd_uint_t *w, const mpd_uint_t *u, const mpd_uint_t *v,
+        mpd_size_t ulen, mpd_size_t vlen)
+{
+    mpd_uint_t *rdata;
+    mpd_size_t rsize = ulen + vlen;
 
-    return i-1;
-}
+    if (vlen <= MPD_KARATSUBA_BASECASE) {
+        mpd_uint_zero(w, rsize);
+        _mpd_basemul(w, v, u, vlen, ulen);
+        return 1;
+    }
 
-/*
- * Initial approximation for the inverse square root function.
+    if (rsize <= MPD_KARATSUBA_CUTOFF) {
+        rdata = _mpd_kmul(u, v, ulen, vlen, &rsize);
+    }
+    else if (vlen <= _mpd_toom_cutoff()) {
+        rdata = _mpd_tmul(u, v, ulen, vlen, &rsize);
+    }
+    else if (rsize <= 3*MPD_MAXTRANSFORM_2N) {
+        rdata = _mpd_fntmul(u, v, ulen, vlen, &rsize);
+    }
+    else {
+        rdata = _mpd_kmul_fnt(u, v, ulen, vlen, &rsize);
+    }
+    if (rdata == NULL) {
+        return 0;
+    }
+
+    memcpy(w, rdata, (ulen+vlen) * sizeof *w);
+    mpd_free(rdata);
+    return 1;
+}
+
+/* Compare u and v, both of length n. */
+static int
+_bz_cmp(const mpd_uint_t *u, const mpd_uint_t *v, mpd_size_t n)
+{
+    while (n-- > 0) {
+        if (u[n] != v[n]) {
+            return u[n] < v[n] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+/* q := q - 1. Assumption: q > 0. */
+static void
+_bz_decr(mpd_uint_t *q)
+{
+    for (; *q == 0; q++) {
+        *q = MPD_RADIX-1;
+    }
+    *q -= 1;
+}
+
+static int _bz_divpart(mpd_uint_t *q, mpd_uint_t *a, const mpd_uint_t *b,
+                       mpd_uint_t *w, mpd_size_t qn, mpd_size_t bn);
+
+/*
+ * q := a / b, a := a % b. a has 2n words and b has n words. Assumptions:
+ * The most significant word of b is at least MPD_RADIX/2 and the upper
+ * half of a is less than b. The quotient has n words, the upper half of
+ * a is zero on return. w is a work array of n+1 words. Return 0 on malloc
+ * error.
+ */
+static int
+_bz_div2n1n(mpd_uint_t *q, mpd_uint_t *a, const mpd_uint_t *b,
+            mpd_uint_t *w, mpd_size_t n)
+{
+    mpd_size_t h;
+
+    if (n == 1) {
+        a[0] = _mpd_shortdiv(w, a, 2, b[0]);
+        a[1] = 0;
+        q[0] = w[0];
+        return 1;
+    }
+    if (n <= (mpd_size_t)MPD_BZDIV_CUTOFF) {
+        /* The quotient has a zero word at index n. */
+        if (_mpd_basedivmod(w, a, a, b, 2*n, n) < 0) {
+            return 0;
+        }
+        memcpy(q, w, n * sizeof *q);
+        mpd_uint_zero(a+n, n);
+        return 1;
+    }
+
+    h = n / 2;
+    return _bz_divpart(q+h, a+h, b, w, n-h, n) &&
+           _bz_divpart(q, a, b, w, h, n);
+}
+
+/*
+ * q := a / b, a := a % b. a has qn+bn words and b has bn words, qn < bn.
+ * Assumptions: The most significant word of b is at least MPD_RADIX/2 and
+ * the upper bn words of a are less than b. The quotient has qn words, the
+ * upper qn words of a are zero on return. w is a work array of bn+1 words.
+ * Return 0 on malloc error.
+ */
+static int
+_bz_divpart(mpd_uint_t *q, mpd_uint_t *a, const mpd_uint_t *b,
+            mpd_uint_t *w, mpd_size_t qn, mpd_size_t bn)
+{
+    const mpd_uint_t *b1 = b+(bn-qn);  /* upper qn words of b */
+    mpd_size_t i;
+    int k;
+
+    assert(qn < bn);
+
+    /* Estimate q from the upper 2*qn words of a and b1. The estimate is
+       at most two units too large. */
+    if (_bz_cmp(a+bn, b1, qn) < 0) {
+        if (!_bz_div2n1n(q, a+(bn-qn), b1, w, qn)) {
+            return 0;
+        }
+    }
+    else {
+        /* The upper qn words of a are equal to b1. With
+           q := MPD_RADIX**qn - 1 the remainder is a[bn-qn:bn] + b1. */
+        for (i = 0; i < qn; i++) {
+            q[i] = MPD_RADIX-1;
+        }
+        mpd_uint_zero(a+bn, qn);
+        a[bn] = _mpd_baseadd(a+(bn-qn), a+(bn-qn), b1, qn, qn);
+    }
+
+    /* a := a - q * (lower bn-qn words of b) */
+    if (qn <= bn-qn) {
+        if (!_bz_mul(w, b, q, bn-qn, qn)) {
+            return 0;
+        }
+    }
+    else {
+        if (!_bz_mul(w, q, b, qn, bn-qn)) {
+            return 0;
+        }
+    }
+    if (a[bn] != 0 || _bz_cmp(a, w, bn) >= 0) {
+        _mpd_basesub(a, a, w, bn+1, bn);
+        return 1;
+    }
+
+    /* The remainder is negative. Let a := abs(remainder) and add b until
+       the remainder is non-negative. */
+    _mpd_basesub(a, w, a, bn, bn);
+    for (k = 0;; k++) {
+        assert(k < 2);
+        _bz_decr(q);
+        if (_bz_cmp(a, b, bn) <= 0) {
+            _mpd_basesub(a, b, a, bn, bn);
+            return 1;
+        }
+        _mpd_basesubfrom(a, b, bn);
+    }
+}
+
+/*
+ * Same as _mpd_basedivmod(), with the divisor v (len n+1, v[n] == 0)
+ * already normalized by the factor d. Divisors of more than
+ * MPD_BZDIV_CUTOFF words use recursive division. The quotient is computed
+ * in blocks of n words, starting with a shorter block at the most
+ * significant end.
+ */
+static int
+_mpd_base_divmod_norm(mpd_uint_t *q, mpd_uint_t *r,
+                      const mpd_uint_t *uconst, const mpd_uint_t *v,
+                      mpd_uint_t d, mpd_size_t nplusm, mpd_size_t n)
+{
+    mpd_uint_t ustatic[MPD_MINALLOC_MAX];
+    mpd_uint_t *u = ustatic, *w;
+    mpd_size_t qn, j, size, mark = 0;
+    int retval = -1;
+
+    assert(n > 1 && nplusm >= n);
+
+    /* u and the work array for recursive division */
+    size = add_size_t(nplusm, 1);
+    if (n > (mpd_size_t)MPD_BZDIV_CUTOFF) {
+        size = add_size_t(size, n+1);
+    }
+    if (size > MPD_MINALLOC_MAX) {
+        if ((u = _mpd_scratch_alloc(size, &mark)) == NULL) {
+            return -1;
+        }
+    }
+    w = u + (nplusm+1);
+
+    /* normalize: the upper n words of u are less than v */
+    _mpd_shortmul(u, uconst, nplusm, d);
+
+    if (n <= (mpd_size_t)MPD_BZDIV_CUTOFF) {
+        _mpd_basedivmod_norm(q, u, v, nplusm, n);
+    }
+    else {
+        /* quotient words */
+        qn = nplusm - n + 1;
+
+        j = qn - qn % n;
+        if (j < qn) {
+            if (!_bz_divpart(q+j, u+j, v, w, qn-j, n)) {
+                goto out;
+            }
+        }
+        while (j > 0) {
+            j -= n;
+            if (!_bz_div2n1n(q+j, u+j, v, w, n)) {
+                goto out;
+            }
+        }
+    }
+
+    /* D8: unnormalize */
+    if (r != NULL) {
+        _mpd_shortdiv(r, u, n, d);
+        retval = 0;
+    }
+    else {
+        retval = !_mpd_isallzero(u, n);
+    }
+
+
+out:
+    if (u != ustatic) _mpd_scratch_free(u, mark);
+    return retval;
+}
+
+/* Same as _mpd_basedivmod(), using recursive division. */
+static int
+_mpd_base_bzdivmod(mpd_uint_t *q, mpd_uint_t *r,
+                   const mpd_uint_t *uconst, const mpd_uint_t *vconst,
+                   mpd_size_t nplusm, mpd_size_t n)
+{
+    mpd_uint_t *v;
+    mpd_uint_t d;
+    mpd_size_t mark;
+    int retval;
+
+    assert(n > 1 && nplusm >= n);
+
+    if ((v = _mpd_scratch_alloc(n+1, &mark)) == NULL) {
+        return -1;
+    }
+
+    d = MPD_RADIX / (vconst[n-1] + 1);
+    _mpd_shortmul(v, vconst, n, d);
+
+    retval = _mpd_base_divmod_norm(q, r, uconst, v, d, nplusm, n);
+
+    _mpd_scratch_free(v, mark);
+    return retval;
+}
+
+/* LIBMPDEC_ONLY */
+/*
+ * Schedule the optimal precision increase for the Newton iteration.
+ *   v := input operand
+ *   z_0 := initial approximation
+ *   initprec := natural number such that abs(sqrt(v) - z_0) < 10**-initprec
+ *   maxprec := target precision
+ *
+ * For convenience the output klist contains the elements in reverse order:
+ *   klist := [k_n-1, ..., k_0], where
+ *     1) k_0 <= initprec and
+ *     2) abs(sqrt(v) - result) < 10**(-2*k_n-1 + 2) <= 10**-maxprec.
+ */
+static inline int
+invroot_schedule_prec(mpd_ssize_t klist[MPD_MAX_PREC_LOG2],
+                      mpd_ssize_t maxprec, mpd_ssize_t initprec)
+{
+    mpd_ssize_t k;
+    int i;
+
+    assert(maxprec >= 3 && initprec >= 3);
+    if (maxprec <= initprec) return -1;
+
+    i = 0; k = maxprec;
+    do {
+        k = (k+3) / 2;
+        klist[i++] = k;
+    } while (k > initprec);
+
+    return i-1;
+}
+
+/*
+ * Initial approximation for the inverse square root function.
  *   Input:
  *     v := rational number, with 1 <= v < 100
  *     vhat := floor(v * 10**6)
@@ -8029,6 +10390,104 @@ mpd_qinvroot(mpd_t *result, const mpd_t *a, const mpd_context_t *ctx,
 }
 /* END LIBMPDEC_ONLY */
 
+/*
+ * Integer square root with the coupled iteration of Karp and Markstein.
+ * Let n be the number of digits of sqrt(c) and h = ceil(n/2) + MPD_ISQRT_GUARD.
+ * Then
+ *
+ *   z = 1/sqrt(c) * (1 + e1),          abs(e1) < 10**-h     (_mpd_qinvroot)
+ *   y0 = c * z rounded to h digits = sqrt(c) * (1 + d),   abs(d) < 6 * 10**-h
+ *   y = y0 + z * (c - y0**2) / 2,
+ *
+ * where c - y0**2 is exact and the last product is rounded to h digits,
+ * so the inverse square root and the final multiplication only need half
+ * the precision. Expanding the terms, y = sqrt(c) * (1 + e) with
+ *
+ *   abs(e) <= d**2/2 + abs(e1*d) + 10**(1-h) * abs(d) + O(10**-3h)
+ *          < 10**(3-2*h) <= 10**(-n-7),
+ *
+ * so abs(y - sqrt(c)) < 10**-7. If y is not within 10**-5 of an integer,
+ * sqrt(c) lies strictly between the same two integers as y. Otherwise the
+ * nearest integer is checked by squaring it.
+ */
+#define MPD_ISQRT_GUARD 5
+
+/*
+ * Set result to floor(sqrt(c)) for an integer c > 0. Return 1 if the square
+ * root is exact, 0 otherwise. On failure, result is NaN and the error is
+ * added to status.
+ */
+static int
+_mpd_qisqrt_coupled(mpd_t *result, const mpd_t *c, uint32_t *status)
+{
+    uint32_t workstatus = 0;
+    mpd_context_t maxctx, hctx;
+    MPD_NEW_STATIC(z,0,0,0,0);
+    MPD_NEW_STATIC(d,0,0,0,0);
+    MPD_NEW_STATIC(s,0,0,0,0);
+    MPD_NEW_CONST(one_half,0,-1,1,1,1,5);
+    mpd_ssize_t n;
+    int exact = 0;
+
+    assert(mpd_isinteger(c) && !mpd_iszero(c) && c->exp == 0);
+
+    n = (c->digits + 1) / 2;
+    mpd_maxcontext(&maxctx);
+    mpd_maxcontext(&hctx);
+    hctx.prec = (n + 1) / 2 + MPD_ISQRT_GUARD;
+
+    /* result := y0, z := 1/sqrt(c) */
+    _mpd_qinvroot(&z, c, &hctx, &workstatus);
+    mpd_qmul(result, c, &z, &hctx, &workstatus);
+
+    /* result := y0 + z * (c - y0**2) / 2 */
+    _mpd_qmul_exact(&d, result, result, &maxctx, &workstatus);
+    _mpd_qsub_exact(&d, c, &d, &maxctx, &workstatus);
+    mpd_qmul(&d, &z, &d, &hctx, &workstatus);
+    mpd_qmul(&d, &d, &one_half, &maxctx, &workstatus);
+    _mpd_qadd_exact(result, result, &d, &maxctx, &workstatus);
+
+    /* s := nearest integer, d := y - s */
+    mpd_qrescale(&s, result, 0, &maxctx, &workstatus);
+    _mpd_qsub_exact(&d, result, &s, &maxctx, &workstatus);
+    if (workstatus & MPD_Errors) {
+        goto error;
+    }
+
+    if (mpd_iszero(&d) || mpd_adjexp(&d) < -5) {
+        /* d := c - s**2 */
+        _mpd_qmul_exact(&d, &s, &s, &maxctx, &workstatus);
+        _mpd_qsub_exact(&d, c, &d, &maxctx, &workstatus);
+        if (workstatus & MPD_Errors) {
+            goto error;
+        }
+        exact = mpd_iszero(&d);
+    }
+
+    if (mpd_isnegative(&d)) {
+        _mpd_qsub_exact(&s, &s, &one, &maxctx, &workstatus);
+        if (workstatus & MPD_Errors) {
+            goto error;
+        }
+    }
+
+    mpd_qcopy(result, &s, &workstatus);
+    if (workstatus & MPD_Errors) {
+        goto error;
+    }
+
+
+out:
+    mpd_del(&z);
+    mpd_del(&d);
+    mpd_del(&s);
+    return exact;
+
+error:
+    mpd_seterror(result, workstatus&MPD_Errors, status);
+    goto out;
+}
+
 /* Algorithm from decimal.py */
 static void
 _mpd_qsqrt(mpd_t *result, const mpd_t *a, const mpd_context_t *ctx,
@@ -8098,35 +10557,48 @@ _mpd_qsqrt(mpd_t *result, const mpd_t *a, const mpd_context_t *ctx,
 
     ideal_exp -= shift;
 
-    /* find result = floor(sqrt(c)) using Newton's method */
-    if (!mpd_qshiftl(result, &one, prec, status)) {
-        goto malloc_error;
-    }
-
-    while (1) {
-        _mpd_qdivmod(&q, &r, &c, result, &maxcontext, &maxcontext.status);
-        if (mpd_isspecial(result) || mpd_isspecial(&q)) {
-            mpd_seterror(result, maxcontext.status&MPD_Errors, status);
-            goto out;
-        }
-        if (_mpd_cmp(result, &q) <= 0) {
-            break;
-        }
-        _mpd_qadd_exact(result, result, &q, &maxcontext, &maxcontext.status);
+    if (prec / MPD_RDIGITS >= MPD_SQRT_COUPLED_CUTOFF) {
+        /* find result = floor(sqrt(c)) with the coupled iteration */
+        int rexact = _mpd_qisqrt_coupled(result, &c, &maxcontext.status);
         if (mpd_isspecial(result)) {
             mpd_seterror(result, maxcontext.status&MPD_Errors, status);
             goto out;
         }
-        _mpd_qdivmod(result, &r, result, &two, &maxcontext, &maxcontext.status);
+        exact = exact && rexact;
     }
+    else {
+        /* find result = floor(sqrt(c)) using Newton's method */
+        if (!mpd_qshiftl(result, &one, prec, status)) {
+            goto malloc_error;
+        }
 
-    if (exact) {
-        _mpd_qmul_exact(&r, result, result, &maxcontext, &maxcontext.status);
-        if (mpd_isspecial(&r)) {
-            mpd_seterror(result, maxcontext.status&MPD_Errors, status);
-            goto out;
+        while (1) {
+            _mpd_qdivmod(&q, &r, &c, result, NULL, &maxcontext,
+                         &maxcontext.status);
+            if (mpd_isspecial(result) || mpd_isspecial(&q)) {
+                mpd_seterror(result, maxcontext.status&MPD_Errors, status);
+                goto out;
+            }
+            if (_mpd_cmp(result, &q) <= 0) {
+                break;
+            }
+            _mpd_qadd_exact(result, result, &q, &maxcontext, &maxcontext.status);
+            if (mpd_isspecial(result)) {
+                mpd_seterror(result, maxcontext.status&MPD_Errors, status);
+                goto out;
+            }
+            _mpd_qdivmod(result, &r, result, &two, NULL, &maxcontext,
+                         &maxcontext.status);
+        }
+
+        if (exact) {
+            _mpd_qmul_exact(&r, result, result, &maxcontext, &maxcontext.status);
+            if (mpd_isspecial(&r)) {
+                mpd_seterror(result, maxcontext.status&MPD_Errors, status);
+                goto out;
+            }
+            exact = (_mpd_cmp(&r, &c) == 0);
         }
-        exact = (_mpd_cmp(&r, &c) == 0);
     }
 
     if (exact) {
@@ -8254,7 +10726,7 @@ mpd_sizeinbase(const mpd_t *a, uint32_t base)
 
 /* Space needed to import a base 'base' integer of length 'srclen'. */
 static mpd_ssize_t
-_mpd_importsize(size_t srclen, uint32_t base)
+_mpd_importsize(size_t srclen, mpd_uint_t base)
 {
     double x;
     double upper_bound;
@@ -8297,11 +10769,13 @@ static size_t
 _baseconv_to_u16(uint16_t **w, size_t wlen, mpd_uint_t wbase,
                  mpd_uint_t *u, mpd_ssize_t ulen)
 {
+    struct word_inverse inv;
     size_t n = 0;
 
     assert(wlen > 0 && ulen > 0);
     assert(wbase <= (1U<<16));
 
+    _mpd_init_word_inverse(&inv, wbase);
     do {
         if (n >= wlen) {
             if (!mpd_resize_u16(w, n+1)) {
@@ -8309,7 +10783,7 @@ _baseconv_to_u16(uint16_t **w, size_t wlen, mpd_uint_t wbase,
             }
             wlen = n+1;
         }
-        (*w)[n++] = (uint16_t)_mpd_shortdiv(u, u, ulen, wbase);
+        (*w)[n++] = (uint16_t)_mpd_shortdiv_inv(u, u, ulen, &inv);
         /* ulen is at least 1. u[ulen-1] can only be zero if ulen == 1. */
         ulen = _mpd_real_size(u, ulen);
 
@@ -8361,11 +10835,13 @@ static size_t
 _baseconv_to_smaller(uint32_t **w, size_t wlen, uint32_t wbase,
                      mpd_uint_t *u, mpd_ssize_t ulen, mpd_uint_t ubase)
 {
+    struct word_inverse inv;
     size_t n = 0;
 
     assert(wlen > 0 && ulen > 0);
     assert(wbase < ubase);
 
+    _mpd_init_word_inverse(&inv, wbase);
     do {
         if (n >= wlen) {
             if (!mpd_resize_u32(w, n+1)) {
@@ -8373,7 +10849,7 @@ _baseconv_to_smaller(uint32_t **w, size_t wlen, uint32_t wbase,
             }
             wlen = n+1;
         }
-        (*w)[n++] = (uint32_t)_mpd_shortdiv_b(u, u, ulen, wbase, ubase);
+        (*w)[n++] = (uint32_t)_mpd_shortdiv_inv_b(u, u, ulen, &inv, ubase);
         /* ulen is at least 1. u[ulen-1] can only be zero if ulen == 1. */
         ulen = _mpd_real_size(u, ulen);
 
@@ -8406,101 +10882,668 @@ _baseconv_to_larger(uint32_t **w, size_t wlen, mpd_uint_t wbase,
     size_t n = 0;
     mpd_uint_t carry;
 
-    assert(wlen > 0 && ulen > 0);
-    assert(ubase < wbase);
+    assert(wlen > 0 && ulen > 0);
+    assert(ubase < wbase);
+
+    (*w)[n++] = u[--ulen];
+    while (--ulen != SIZE_MAX) {
+        carry = _mpd_shortmul_b(*w, *w, n, ubase, wbase);
+        if (carry) {
+            if (n >= wlen) {
+                if (!mpd_resize_u32(w, n+1)) {
+                    return SIZE_MAX;
+                }
+                wlen = n+1;
+            }
+            (*w)[n++] = carry;
+        }
+        carry = _mpd_shortadd_b(*w, n, u[ulen], wbase);
+        if (carry) {
+            if (n >= wlen) {
+                if (!mpd_resize_u32(w, n+1)) {
+                    return SIZE_MAX;
+                }
+                wlen = n+1;
+            }
+            (*w)[n++] = carry;
+        }
+    }
+
+    return n;
+}
+
+/* target base wbase < source base ubase */
+static size_t
+_coeff_from_larger_base(mpd_t *w, size_t wlen, mpd_uint_t wbase,
+                        mpd_uint_t *u, mpd_ssize_t ulen, mpd_uint_t ubase,
+                        uint32_t *status)
+{
+    struct word_inverse inv;
+    size_t n = 0;
+
+    assert(wlen > 0 && ulen > 0);
+    assert(wbase < ubase);
+
+    _mpd_init_word_inverse(&inv, wbase);
+    do {
+        if (n >= wlen) {
+            if (!mpd_qresize(w, n+1, status)) {
+                return SIZE_MAX;
+            }
+            wlen = n+1;
+        }
+        w->data[n++] = (uint32_t)_mpd_shortdiv_inv_b(u, u, ulen, &inv, ubase);
+        /* ulen is at least 1. u[ulen-1] can only be zero if ulen == 1. */
+        ulen = _mpd_real_size(u, ulen);
+
+    } while (u[ulen-1] != 0);
+
+    return n;
+}
+#endif
+
+/* target base 'wbase' > source base 'ubase' */
+static size_t
+_coeff_from_smaller_base(mpd_t *w, mpd_ssize_t wlen, mpd_uint_t wbase,
+                         const uint32_t *u, size_t ulen, mpd_uint_t ubase,
+                         uint32_t *status)
+{
+    mpd_ssize_t n = 0;
+    mpd_uint_t carry;
+
+    assert(wlen > 0 && ulen > 0);
+    assert(wbase > ubase);
+
+    w->data[n++] = u[--ulen];
+    while (--ulen != SIZE_MAX) {
+        carry = _mpd_shortmul_b(w->data, w->data, n, ubase, wbase);
+        if (carry) {
+            if (n >= wlen) {
+                if (!mpd_qresize(w, n+1, status)) {
+                    return SIZE_MAX;
+                }
+                wlen = n+1;
+            }
+            w->data[n++] = carry;
+        }
+        carry = _mpd_shortadd_b(w->data, n, u[ulen], wbase);
+        if (carry) {
+            if (n >= wlen) {
+                if (!mpd_qresize(w, n+1, status)) {
+                    return SIZE_MAX;
+                }
+                wlen = n+1;
+            }
+            w->data[n++] = carry;
+        }
+    }
+
+    return n;
+}
+
+/*
+ * Digits of an integer in base 'base', least significant digit first, as
+ * they are stored in the array of a conversion. u16 and u32 arrays hold one
+ * digit per element. u64 limbs and bytes use the binary base MPD_BINBASE,
+ * so a limb holds MPD_BIN_PER_U64 digits and a digit MPD_BIN_BYTES bytes.
+ * Byte arrays are little-endian while the digits are written; big-endian
+ * arrays are read from the end.
+ */
+#define MPD_BINBITS (MPD_BITS_PER_UINT/2)
+#define MPD_BINBASE ((mpd_uint_t)1 << MPD_BINBITS)
+#define MPD_BIN_PER_U64 (64/MPD_BINBITS)
+#define MPD_BIN_BYTES (MPD_BINBITS/8)
+
+enum { BASECONV_U16, BASECONV_U32, BASECONV_U64, BASECONV_BYTES };
+
+struct baseconv_digits {
+    int type;
+    int order;          /* MPD_LITTLE_ENDIAN or MPD_BIG_ENDIAN, bytes only */
+    void *data;         /* read-only for imports */
+    size_t len;         /* number of elements */
+    size_t n;           /* export: used elements */
+};
+
+/* Number of digits in the array. */
+static inline size_t
+_baseconv_ndigits(const struct baseconv_digits *d)
+{
+    switch (d->type) {
+    case BASECONV_U64:
+        return d->len * MPD_BIN_PER_U64;
+    case BASECONV_BYTES:
+        return (d->len + MPD_BIN_BYTES-1) / MPD_BIN_BYTES;
+    default:
+        return d->len;
+    }
+}
+
+/* Return digit j. */
+static inline mpd_uint_t
+_baseconv_get(const struct baseconv_digits *d, size_t j)
+{
+    const uint8_t *p;
+    size_t i, k;
+    mpd_uint_t v;
+
+    switch (d->type) {
+    case BASECONV_U16:
+        return ((const uint16_t *)d->data)[j];
+    case BASECONV_U32:
+        return ((const uint32_t *)d->data)[j];
+    case BASECONV_U64:
+        i = j / MPD_BIN_PER_U64;
+        k = j % MPD_BIN_PER_U64;
+        return (mpd_uint_t)(((const uint64_t *)d->data)[i] >>
+                            (k * MPD_BINBITS)) & (MPD_BINBASE-1);
+    default:
+        p = d->data;
+        v = 0;
+        for (k = MPD_BIN_BYTES; k-- > 0; ) {
+            i = j * MPD_BIN_BYTES + k;
+            if (i < d->len) {
+                if (d->order == MPD_BIG_ENDIAN) {
+                    i = d->len-1 - i;
+                }
+                v = (v << 8) | p[i];
+            }
+        }
+        return v;
+    }
+}
+
+/*
+ * Store digit j. Digits beyond the array must be zero. Return 0 on
+ * success, -1 if a nonzero digit does not fit.
+ */
+static inline int
+_baseconv_put(struct baseconv_digits *d, size_t j, mpd_uint_t v)
+{
+    uint64_t *limbs;
+    uint8_t *p;
+    size_t i, k;
+
+    switch (d->type) {
+    case BASECONV_U16: case BASECONV_U32:
+        if (j >= d->len) {
+            return v ? -1 : 0;
+        }
+        if (d->type == BASECONV_U16) {
+            ((uint16_t *)d->data)[j] = (uint16_t)v;
+        }
+        else {
+            ((uint32_t *)d->data)[j] = (uint32_t)v;
+        }
+        if (v && j >= d->n) {
+            d->n = j+1;
+        }
+        return 0;
+    case BASECONV_U64:
+        i = j / MPD_BIN_PER_U64;
+        k = j % MPD_BIN_PER_U64;
+        if (i >= d->len) {
+            return v ? -1 : 0;
+        }
+        limbs = d->data;
+        if (k == 0) {
+            limbs[i] = v;
+        }
+        else {
+            limbs[i] |= (uint64_t)v << (k * MPD_BINBITS);
+        }
+        if (v && i >= d->n) {
+            d->n = i+1;
+        }
+        return 0;
+    default:
+        p = d->data;
+        for (k = 0; k < MPD_BIN_BYTES; k++, v >>= 8) {
+            i = j * MPD_BIN_BYTES + k;
+            if (i >= d->len) {
+                return v ? -1 : 0;
+            }
+            p[i] = (uint8_t)v;
+            if ((v & 0xff) && i >= d->n) {
+                d->n = i+1;
+            }
+        }
+        return 0;
+    }
+}
+
+/*
+ * Divide-and-conquer conversion for integers with more than
+ * MPD_BASECONV_CUTOFF words in the other base. An integer with up to
+ * m * 2**k words in that base is split into quotient and remainder by
+ * pow[k-1], or joined from the two halves by a product with pow[k-1],
+ * where pow[j] = base**(m * 2**j). m is chosen so that the leaves are at
+ * most as long as the cutoff. They are converted by the quadratic
+ * algorithms. Each power is used by all nodes at its level, so it is
+ * prepared once: for division with a stored reciprocal (export) or as a
+ * product with precomputed transforms (import). With k == 0, the whole
+ * integer is a single leaf.
+ */
+#define MPD_BASECONV_MAXLEVELS 64
+
+struct baseconv_tree {
+    mpd_uint_t base;
+    size_t m;                   /* words in base 'base' per leaf */
+    int levels;                 /* number of powers */
+    mpd_t *pow[MPD_BASECONV_MAXLEVELS];
+    mpd_divisor_t *dv[MPD_BASECONV_MAXLEVELS];
+    mpd_mulplan_t *plan[MPD_BASECONV_MAXLEVELS];
+    struct word_inverse inv;    /* inverse of base, export leaves */
+    mpd_uint_t *u;              /* scratch space for the leaves */
+    mpd_uint_t ubuf[MPD_MINALLOC_MAX]; /* u for short leaves */
+};
+
+/*
+ * Number of levels for an integer with n words in the other base. On
+ * return, *m is the number of words per leaf.
+ */
+static int
+_baseconv_levels(size_t *m, size_t n)
+{
+    size_t maxleaf = (size_t)MPD_BASECONV_CUTOFF;
+    int k;
+
+    k = 0;
+    while (((n-1) >> k) >= maxleaf) {
+        k++;
+    }
+
+    *m = ((n-1) >> k) + 1;
+    return k;
+}
+
+static void
+_baseconv_tree_del(struct baseconv_tree *t)
+{
+    int k;
+
+    for (k = 0; k < t->levels; k++) {
+        if (t->dv[k]) mpd_del_divisor(t->dv[k]);
+        if (t->plan[k]) mpd_del_mulplan(t->plan[k]);
+        mpd_del(t->pow[k]);
+    }
+    if (t->u != t->ubuf) mpd_free(t->u);
+}
+
+/*
+ * Compute the powers pow[0], ..., pow[levels-1] and prepare them for
+ * division if 'split' is set (export), for multiplication otherwise
+ * (import). Return 0 on success, -1 on failure.
+ */
+static int
+_baseconv_tree_init(struct baseconv_tree *t, mpd_uint_t base, size_t m,
+                    int levels, int split, uint32_t *status)
+{
+    mpd_context_t maxcontext;
+    MPD_NEW_STATIC(b,0,0,0,0);
+    size_t n;
+    int k;
+
+    assert(base >= 2);
+    assert(levels < MPD_BASECONV_MAXLEVELS);
+
+    t->base = base;
+    t->m = m;
+    t->levels = 0;
+
+    /* An export leaf is less than base**m, an import leaf has m digits. */
+    n = (size_t)_mpd_importsize(m, base) + 1;
+    if (n < m) {
+        n = m;
+    }
+    t->u = t->ubuf;
+    if (n > MPD_MINALLOC_MAX) {
+        if ((t->u = mpd_alloc(n, sizeof *t->u)) == NULL) {
+            *status |= MPD_Malloc_error;
+            return -1;
+        }
+    }
+    _mpd_init_word_inverse(&t->inv, base);
+
+    mpd_maxcontext(&maxcontext);
+    for (k = 0; k < levels; k++) {
+        t->dv[k] = NULL;
+        t->plan[k] = NULL;
+        if ((t->pow[k] = mpd_qnew()) == NULL) {
+            goto malloc_error;
+        }
+        t->levels++;
+
+        if (k == 0) {
+            mpd_qset_uint(&b, base, &maxcontext, status);
+            _mpd_qpow_uint(t->pow[0], &b, m, MPD_POS, &maxcontext, status);
+        }
+        else {
+            mpd_qmul(t->pow[k], t->pow[k-1], t->pow[k-1], &maxcontext,
+                     status);
+        }
+        if (mpd_isspecial(t->pow[k])) {
+            goto malloc_error;
+        }
+
+        if (split) {
+            t->dv[k] = mpd_qnew_divisor(t->pow[k], t->pow[k]->digits,
+                                        status);
+            if (t->dv[k] == NULL) {
+                goto malloc_error;
+            }
+        }
+        else {
+            t->plan[k] = mpd_qnew_mulplan(t->pow[k], t->pow[k]->digits,
+                                          status);
+            if (t->plan[k] == NULL) {
+                goto malloc_error;
+            }
+        }
+    }
+
+    mpd_del(&b);
+    return 0;
+
+malloc_error:
+    mpd_del(&b);
+    _baseconv_tree_del(t);
+    *status |= MPD_Malloc_error;
+    return -1;
+}
+
+/*
+ * Store the m * 2**k digits of x < base**(m * 2**k) in base t->base,
+ * starting at digit 'pos' of w.
+ */
+static int
+_baseconv_split(struct baseconv_digits *w, size_t pos, const mpd_t *x,
+                int k, struct baseconv_tree *t, uint32_t *status)
+{
+    mpd_context_t maxcontext;
+    MPD_NEW_STATIC(q,0,0,0,0);
+    MPD_NEW_STATIC(r,0,0,0,0);
+    mpd_ssize_t ulen;
+    mpd_uint_t v;
+    size_t half, i;
+    int ret = -1;
+
+    if (mpd_iszerocoeff(x)) {
+        for (i = 0; i < (t->m << k); i++) {
+            (void)_baseconv_put(w, pos+i, 0);
+        }
+        return 0;
+    }
+
+    if (k == 0) {
+        ulen = x->len;
+        memcpy(t->u, x->data, ulen * (sizeof *t->u));
+        for (i = 0; i < t->m; i++) {
+            v = _mpd_shortdiv_inv_b(t->u, t->u, ulen, &t->inv, MPD_RADIX);
+            ulen = _mpd_real_size(t->u, ulen);
+            if (_baseconv_put(w, pos+i, v) < 0) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    mpd_maxcontext(&maxcontext);
+    half = t->m << (k-1);
+
+    mpd_qdivmod_prepared(&q, &r, x, t->dv[k-1], &maxcontext, status);
+    if (mpd_isspecial(&q) || mpd_isspecial(&r)) {
+        goto out;
+    }
+    if (_baseconv_split(w, pos, &r, k-1, t, status) < 0 ||
+        _baseconv_split(w, pos+half, &q, k-1, t, status) < 0) {
+        goto out;
+    }
+    ret = 0;
+
+out:
+    mpd_del(&q);
+    mpd_del(&r);
+    return ret;
+}
+
+/*
+ * Store the digits of the integer u in base 'wbase' in w, which must be
+ * able to hold nwords digits, the number of digits of u or more. Integers
+ * with more than MPD_BASECONV_CUTOFF digits are split recursively. On
+ * success, w->n is the number of used elements of w. Return 0 on success,
+ * -1 if the digits do not fit into w or if an allocation fails, in which
+ * case MPD_Malloc_error is set.
+ */
+static int
+_baseconv_export(struct baseconv_digits *w, const mpd_t *u, size_t nwords,
+                 mpd_uint_t wbase, uint32_t *status)
+{
+    struct baseconv_tree t;
+    mpd_t x;
+    size_t m;
+    int k, ret;
+
+    _mpd_copy_shared(&x, u);
+    mpd_set_positive(&x);
+    x.exp = 0;
+
+    k = _baseconv_levels(&m, nwords);
+    if (_baseconv_tree_init(&t, wbase, m, k, 1, status) < 0) {
+        return -1;
+    }
+
+    w->n = 1;
+    ret = _baseconv_split(w, 0, &x, k, &t, status);
+
+    _baseconv_tree_del(&t);
+    return ret;
+}
+
+/* Horner's scheme for the n digits of u from digit 'pos', base < MPD_RADIX. */
+static size_t
+_coeff_from_digits(mpd_t *w, mpd_ssize_t wlen,
+                   const struct baseconv_digits *u, size_t pos, size_t n,
+                   mpd_uint_t ubase, uint32_t *status)
+{
+    mpd_ssize_t len = 0;
+    mpd_uint_t carry;
+
+    assert(wlen > 0 && n > 0);
+    assert(ubase < MPD_RADIX);
+
+    w->data[len++] = _baseconv_get(u, pos + --n);
+    while (--n != SIZE_MAX) {
+        carry = _mpd_shortmul_c(w->data, w->data, len, ubase);
+        if (carry) {
+            if (len >= wlen) {
+                if (!mpd_qresize(w, len+1, status)) {
+                    return SIZE_MAX;
+                }
+                wlen = len+1;
+            }
+            w->data[len++] = carry;
+        }
+        carry = _mpd_shortadd(w->data, len, _baseconv_get(u, pos+n));
+        if (carry) {
+            if (len >= wlen) {
+                if (!mpd_qresize(w, len+1, status)) {
+                    return SIZE_MAX;
+                }
+                wlen = len+1;
+            }
+            w->data[len++] = carry;
+        }
+    }
+
+    return len;
+}
+
+/* Convert the n <= m digits of u from digit 'pos' to the coefficient of w. */
+static int
+_baseconv_leaf(mpd_t *w, const struct baseconv_digits *u, size_t pos,
+               size_t n, struct baseconv_tree *t, uint32_t *status)
+{
+    mpd_ssize_t wlen = _mpd_importsize(n, t->base);
+    size_t len;
+
+    if (!mpd_qresize(w, wlen, status)) {
+        return -1;
+    }
+
+    if (u->type != BASECONV_U32) {
+        len = _coeff_from_digits(w, wlen, u, pos, n, t->base, status);
+    }
+    else {
+        const uint32_t *src = (const uint32_t *)u->data + pos;
+#ifdef CONFIG_64
+        len = _coeff_from_smaller_base(w, wlen, MPD_RADIX, src, n, t->base,
+                                       status);
+#else
+        if (t->base < MPD_RADIX) {
+            len = _coeff_from_smaller_base(w, wlen, MPD_RADIX, src, n,
+                                           t->base, status);
+        }
+        else {
+            memcpy(t->u, src, n * (sizeof *t->u));
+            len = _coeff_from_larger_base(w, wlen, MPD_RADIX, t->u,
+                                          (mpd_ssize_t)n, t->base, status);
+        }
+#endif
+    }
+    if (len == SIZE_MAX) {
+        return -1;
+    }
+
+    mpd_set_flags(w, MPD_POS);
+    w->exp = 0;
+    w->len = len;
+    mpd_setdigits(w);
+    return 0;
+}
+
+/* Set w to the integer in the n <= m * 2**k digits of u from digit 'pos'. */
+static int
+_baseconv_join(mpd_t *w, const struct baseconv_digits *u, size_t pos,
+               size_t n, int k, struct baseconv_tree *t, uint32_t *status)
+{
+    mpd_context_t maxcontext;
+    MPD_NEW_STATIC(lo,0,0,0,0);
+    MPD_NEW_STATIC(hi,0,0,0,0);
+    size_t half;
+    int ret = -1;
+
+    if (k == 0) {
+        return _baseconv_leaf(w, u, pos, n, t, status);
+    }
+
+    half = t->m << (k-1);
+    if (n <= half) {
+        return _baseconv_join(w, u, pos, n, k-1, t, status);
+    }
+
+    if (_baseconv_join(&lo, u, pos, half, k-1, t, status) < 0 ||
+        _baseconv_join(&hi, u, pos+half, n-half, k-1, t, status) < 0) {
+        goto out;
+    }
+
+    mpd_maxcontext(&maxcontext);
+    mpd_qmul_plan(w, &hi, t->plan[k-1], &maxcontext, status);
+    mpd_qadd(w, w, &lo, &maxcontext, status);
+    if (mpd_isspecial(w)) {
+        goto out;
+    }
+    ret = 0;
+
+out:
+    mpd_del(&lo);
+    mpd_del(&hi);
+    return ret;
+}
+
+/*
+ * Set result to the integer with the digits u in base 'ubase'. Integers
+ * with more than MPD_BASECONV_CUTOFF digits are joined recursively.
+ */
+static void
+_mpd_qimport_digits(mpd_t *result, const struct baseconv_digits *u,
+                    uint8_t sign, mpd_uint_t ubase,
+                    const mpd_context_t *ctx, uint32_t *status)
+{
+    struct baseconv_tree t;
+    size_t n = _baseconv_ndigits(u);
+    size_t m;
+    int k;
+
+    if (_mpd_importsize(n, ubase) == MPD_SSIZE_MAX) {
+        mpd_seterror(result, MPD_Invalid_operation, status);
+        return;
+    }
+
+    k = _baseconv_levels(&m, n);
+    if (_baseconv_tree_init(&t, ubase, m, k, 0, status) < 0) {
+        mpd_seterror(result, MPD_Malloc_error, status);
+        return;
+    }
 
-    (*w)[n++] = u[--ulen];
-    while (--ulen != SIZE_MAX) {
-        carry = _mpd_shortmul_b(*w, *w, n, ubase, wbase);
-        if (carry) {
-            if (n >= wlen) {
-                if (!mpd_resize_u32(w, n+1)) {
-                    return SIZE_MAX;
-                }
-                wlen = n+1;
-            }
-            (*w)[n++] = carry;
-        }
-        carry = _mpd_shortadd_b(*w, n, u[ulen], wbase);
-        if (carry) {
-            if (n >= wlen) {
-                if (!mpd_resize_u32(w, n+1)) {
-                    return SIZE_MAX;
-                }
-                wlen = n+1;
-            }
-            (*w)[n++] = carry;
-        }
+    if (_baseconv_join(result, u, 0, n, k, &t, status) < 0) {
+        mpd_seterror(result, MPD_Malloc_error, status);
+    }
+    else {
+        mpd_set_flags(result, sign);
+        mpd_qfinalize(result, ctx, status);
     }
 
-    return n;
+    _baseconv_tree_del(&t);
 }
 
-/* target base wbase < source base ubase */
+/* Divide-and-conquer conversion to base 'wbase' <= 2**16. */
 static size_t
-_coeff_from_larger_base(mpd_t *w, size_t wlen, mpd_uint_t wbase,
-                        mpd_uint_t *u, mpd_ssize_t ulen, mpd_uint_t ubase,
-                        uint32_t *status)
+_baseconv_dc_to_u16(uint16_t **w, size_t wlen, uint32_t wbase,
+                    const mpd_t *u, uint32_t *status)
 {
-    size_t n = 0;
-
-    assert(wlen > 0 && ulen > 0);
-    assert(wbase < ubase);
+    struct baseconv_digits d;
+    size_t n = mpd_sizeinbase(u, wbase);
 
-    do {
-        if (n >= wlen) {
-            if (!mpd_qresize(w, n+1, status)) {
-                return SIZE_MAX;
-            }
-            wlen = n+1;
+    if (n > wlen) {
+        if (!mpd_resize_u16(w, n)) {
+            return SIZE_MAX;
         }
-        w->data[n++] = (uint32_t)_mpd_shortdiv_b(u, u, ulen, wbase, ubase);
-        /* ulen is at least 1. u[ulen-1] can only be zero if ulen == 1. */
-        ulen = _mpd_real_size(u, ulen);
+        wlen = n;
+    }
 
-    } while (u[ulen-1] != 0);
+    d.type = BASECONV_U16;
+    d.data = *w;
+    d.len = wlen;
+    if (_baseconv_export(&d, u, n, wbase, status) < 0) {
+        return SIZE_MAX;
+    }
 
-    return n;
+    return d.n;
 }
-#endif
 
-/* target base 'wbase' > source base 'ubase' */
+/* Divide-and-conquer conversion to base 'wbase' <= UINT32_MAX. */
 static size_t
-_coeff_from_smaller_base(mpd_t *w, mpd_ssize_t wlen, mpd_uint_t wbase,
-                         const uint32_t *u, size_t ulen, mpd_uint_t ubase,
-                         uint32_t *status)
+_baseconv_dc_to_u32(uint32_t **w, size_t wlen, uint32_t wbase,
+                    const mpd_t *u, uint32_t *status)
 {
-    mpd_ssize_t n = 0;
-    mpd_uint_t carry;
-
-    assert(wlen > 0 && ulen > 0);
-    assert(wbase > ubase);
+    struct baseconv_digits d;
+    size_t n = mpd_sizeinbase(u, wbase);
 
-    w->data[n++] = u[--ulen];
-    while (--ulen != SIZE_MAX) {
-        carry = _mpd_shortmul_b(w->data, w->data, n, ubase, wbase);
-        if (carry) {
-            if (n >= wlen) {
-                if (!mpd_qresize(w, n+1, status)) {
-                    return SIZE_MAX;
-                }
-                wlen = n+1;
-            }
-            w->data[n++] = carry;
-        }
-        carry = _mpd_shortadd_b(w->data, n, u[ulen], wbase);
-        if (carry) {
-            if (n >= wlen) {
-                if (!mpd_qresize(w, n+1, status)) {
-                    return SIZE_MAX;
-                }
-                wlen = n+1;
-            }
-            w->data[n++] = carry;
+    if (n > wlen) {
+        if (!mpd_resize_u32(w, n)) {
+            return SIZE_MAX;
         }
+        wlen = n;
     }
 
-    return n;
+    d.type = BASECONV_U32;
+    d.data = *w;
+    d.len = wlen;
+    if (_baseconv_export(&d, u, n, wbase, status) < 0) {
+        return SIZE_MAX;
+    }
+
+    return d.n;
 }
 
 /*
@@ -8561,8 +11604,14 @@ mpd_qexport_u16(uint16_t **rdata, size_t rlen, uint32_t rbase,
             goto malloc_error;
         }
     }
+    tsrc.exp = 0; /* the shifts keep the exponent of src */
 
-    n = _baseconv_to_u16(rdata, rlen, rbase, tsrc.data, tsrc.len);
+    if (mpd_sizeinbase(&tsrc, rbase) > (size_t)MPD_BASECONV_CUTOFF) {
+        n = _baseconv_dc_to_u16(rdata, rlen, rbase, &tsrc, status);
+    }
+    else {
+        n = _baseconv_to_u16(rdata, rlen, rbase, tsrc.data, tsrc.len);
+    }
     if (n == SIZE_MAX) {
         goto malloc_error;
     }
@@ -8638,14 +11687,23 @@ mpd_qexport_u32(uint32_t **rdata, size_t rlen, uint32_t rbase,
             goto malloc_error;
         }
     }
+    tsrc.exp = 0; /* the shifts keep the exponent of src */
 
 #ifdef CONFIG_64
-    n = _baseconv_to_smaller(rdata, rlen, rbase,
-                             tsrc.data, tsrc.len, MPD_RADIX);
+    if (mpd_sizeinbase(&tsrc, rbase) > (size_t)MPD_BASECONV_CUTOFF) {
+        n = _baseconv_dc_to_u32(rdata, rlen, rbase, &tsrc, status);
+    }
+    else {
+        n = _baseconv_to_smaller(rdata, rlen, rbase,
+                                 tsrc.data, tsrc.len, MPD_RADIX);
+    }
 #else
     if (rbase == MPD_RADIX) {
         n = _copy_equal_base(rdata, rlen, tsrc.data, tsrc.len);
     }
+    else if (mpd_sizeinbase(&tsrc, rbase) > (size_t)MPD_BASECONV_CUTOFF) {
+        n = _baseconv_dc_to_u32(rdata, rlen, rbase, &tsrc, status);
+    }
     else if (rbase < MPD_RADIX) {
         n = _baseconv_to_smaller(rdata, rlen, rbase,
                                  tsrc.data, tsrc.len, MPD_RADIX);
@@ -8699,6 +11757,15 @@ mpd_qimport_u16(mpd_t *result,
         return;
     }
 
+    if (srclen > (size_t)MPD_BASECONV_CUTOFF) {
+        struct baseconv_digits u;
+        u.type = BASECONV_U16;
+        u.data = (void *)srcdata;
+        u.len = srclen;
+        _mpd_qimport_digits(result, &u, srcsign, srcbase, ctx, status);
+        return;
+    }
+
     usrc = mpd_alloc((mpd_size_t)srclen, sizeof *usrc);
     if (usrc == NULL) {
         mpd_seterror(result, MPD_Malloc_error, status);
@@ -8751,6 +11818,19 @@ mpd_qimport_u32(mpd_t *result,
         return;
     }
 
+#ifdef CONFIG_64
+    if (srclen > (size_t)MPD_BASECONV_CUTOFF) {
+#else
+    if (srclen > (size_t)MPD_BASECONV_CUTOFF && srcbase != MPD_RADIX) {
+#endif
+        struct baseconv_digits u;
+        u.type = BASECONV_U32;
+        u.data = (void *)srcdata;
+        u.len = srclen;
+        _mpd_qimport_digits(result, &u, srcsign, srcbase, ctx, status);
+        return;
+    }
+
     if (!mpd_qresize(result, rlen, status)) {
         return;
     }
@@ -8803,6 +11883,242 @@ mpd_qimport_u32(mpd_t *result,
 }
 
 
+/*
+ * Set *x to the integer value of src, which must be a finite integer. The
+ * result either shares the coefficient of src or is stored in tmp.
+ * Return 0 on success, -1 on failure.
+ */
+static int
+_mpd_integer_view(const mpd_t **x, mpd_t *tmp, const mpd_t *src,
+                  uint32_t *status)
+{
+    if (src->exp == 0) {
+        *x = src;
+        return 0;
+    }
+
+    if (src->exp > 0) {
+        if (!mpd_qshiftl(tmp, src, src->exp, status)) {
+            return -1;
+        }
+    }
+    else {
+        if (mpd_qshiftr(tmp, src, -src->exp, status) == MPD_UINT_MAX) {
+            return -1;
+        }
+    }
+
+    tmp->exp = 0;
+    *x = tmp;
+    return 0;
+}
+
+/* Number of binary digits (base MPD_BINBASE) of the integer x. */
+static size_t
+_mpd_bindigits(const mpd_t *x)
+{
+    size_t bits = mpd_sizeinbase(x, 2);
+
+    if (bits == SIZE_MAX) {
+        return SIZE_MAX;
+    }
+    return bits / MPD_BINBITS + 1;
+}
+
+/*
+ * Convert an integer mpd_t to an array of 64-bit limbs, the absolute
+ * value in base 2**64. The least significant limb is (*rdata)[0].
+ *
+ * rdata and rlen are used as in mpd_qexport_u32(). If rdata is NULL, at
+ * least as many limbs as the result needs are allocated. This can be one
+ * more than ceil(mpd_sizeinbase(src, 2) / 64).
+ *
+ * Return value: In case of success, the exact length of rdata, SIZE_MAX
+ * otherwise.
+ */
+size_t
+mpd_qexport_u64(uint64_t **rdata, size_t rlen, const mpd_t *src,
+                uint32_t *status)
+{
+    MPD_NEW_STATIC(tsrc,0,0,0,0);
+    struct baseconv_digits d;
+    const mpd_t *x;
+    int alloc = 0; /* rdata == NULL */
+    size_t n, size;
+
+    if (mpd_isspecial(src) || !_mpd_isint(src)) {
+        *status |= MPD_Invalid_operation;
+        return SIZE_MAX;
+    }
+
+    n = _mpd_bindigits(src);
+    if (n == SIZE_MAX) {
+        *status |= MPD_Invalid_operation;
+        return SIZE_MAX;
+    }
+    size = (n + MPD_BIN_PER_U64-1) / MPD_BIN_PER_U64;
+
+    if (*rdata == NULL) {
+        rlen = size;
+        *rdata = mpd_alloc(rlen, sizeof **rdata);
+        if (*rdata == NULL) {
+            goto malloc_error;
+        }
+        alloc = 1;
+    }
+
+    if (mpd_iszero(src)) {
+        **rdata = 0;
+        return 1;
+    }
+
+    if (rlen < size) {
+        uint8_t err = 0;
+        *rdata = mpd_realloc(*rdata, size, sizeof **rdata, &err);
+        if (err) {
+            goto malloc_error;
+        }
+        rlen = size;
+    }
+
+    if (_mpd_integer_view(&x, &tsrc, src, status) < 0) {
+        goto malloc_error;
+    }
+
+    d.type = BASECONV_U64;
+    d.data = *rdata;
+    d.len = rlen;
+    if (_baseconv_export(&d, x, n, MPD_BINBASE, status) < 0) {
+        goto malloc_error;
+    }
+    n = d.n;
+
+
+out:
+    mpd_del(&tsrc);
+    return n;
+
+malloc_error:
+    if (alloc) {
+        mpd_free(*rdata);
+        *rdata = NULL;
+    }
+    n = SIZE_MAX;
+    *status |= MPD_Malloc_error;
+    goto out;
+}
+
+/*
+ * Convert an integer mpd_t to a byte array holding the absolute value in
+ * base 256, in the byte order 'order' (MPD_LITTLE_ENDIAN or MPD_BIG_ENDIAN).
+ * The array is supplied by the caller and is not resized. rlen ==
+ * mpd_sizeinbase(src, 256) is always sufficient.
+ *
+ * Return value: In case of success, the exact number of bytes written,
+ * SIZE_MAX otherwise. If the value does not fit into rlen bytes,
+ * MPD_Invalid_operation is set.
+ */
+size_t
+mpd_qexport_bytes(uint8_t *rdata, size_t rlen, int order, const mpd_t *src,
+                  uint32_t *status)
+{
+    MPD_NEW_STATIC(tsrc,0,0,0,0);
+    struct baseconv_digits d;
+    uint32_t workstatus = 0;
+    const mpd_t *x;
+    size_t n, i;
+    uint8_t c;
+
+    assert(order == MPD_LITTLE_ENDIAN || order == MPD_BIG_ENDIAN);
+
+    if (mpd_isspecial(src) || !_mpd_isint(src) || rlen == 0) {
+        *status |= MPD_Invalid_operation;
+        return SIZE_MAX;
+    }
+
+    if (mpd_iszero(src)) {
+        rdata[0] = 0;
+        return 1;
+    }
+
+    n = _mpd_bindigits(src);
+    if (n == SIZE_MAX) {
+        *status |= MPD_Invalid_operation;
+        return SIZE_MAX;
+    }
+
+    if (_mpd_integer_view(&x, &tsrc, src, status) < 0) {
+        *status |= MPD_Malloc_error;
+        return SIZE_MAX;
+    }
+
+    d.type = BASECONV_BYTES;
+    d.data = rdata;
+    d.len = rlen;
+    if (_baseconv_export(&d, x, n, MPD_BINBASE, &workstatus) < 0) {
+        *status |= (workstatus & MPD_Malloc_error) ? MPD_Malloc_error
+                                                   : MPD_Invalid_operation;
+        n = SIZE_MAX;
+        goto out;
+    }
+    n = d.n;
+
+    if (order == MPD_BIG_ENDIAN) {
+        for (i = 0; i < n/2; i++) {
+            c = rdata[i];
+            rdata[i] = rdata[n-1-i];
+            rdata[n-1-i] = c;
+        }
+    }
+
+
+out:
+    mpd_del(&tsrc);
+    return n;
+}
+
+/*
+ * Converts an array of 64-bit limbs (base 2**64) to an mpd_t. The least
+ * significant limb of the source is srcdata[0].
+ */
+void
+mpd_qimport_u64(mpd_t *result,
+                const uint64_t *srcdata, size_t srclen,
+                uint8_t srcsign,
+                const mpd_context_t *ctx, uint32_t *status)
+{
+    struct baseconv_digits u;
+
+    assert(srclen > 0);
+
+    u.type = BASECONV_U64;
+    u.data = (void *)srcdata;
+    u.len = srclen;
+    _mpd_qimport_digits(result, &u, srcsign, MPD_BINBASE, ctx, status);
+}
+
+/*
+ * Converts a byte array (base 256) in the byte order 'order' to an mpd_t.
+ */
+void
+mpd_qimport_bytes(mpd_t *result,
+                  const uint8_t *srcdata, size_t srclen,
+                  uint8_t srcsign, int order,
+                  const mpd_context_t *ctx, uint32_t *status)
+{
+    struct baseconv_digits u;
+
+    assert(srclen > 0);
+    assert(order == MPD_LITTLE_ENDIAN || order == MPD_BIG_ENDIAN);
+
+    u.type = BASECONV_BYTES;
+    u.order = order;
+    u.data = (void *)srcdata;
+    u.len = srclen;
+    _mpd_qimport_digits(result, &u, srcsign, MPD_BINBASE, ctx, status);
+}
+
+
 /******************************************************************************/
 /*                                From triple                                 */
 /******************************************************************************/
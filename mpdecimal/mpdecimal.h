@@ -559,6 +559,20 @@ size_t mpd_qexport_u16(uint16_t **rdata, size_t rlen, uint32_t base,
 size_t mpd_qexport_u32(uint32_t **rdata, size_t rlen, uint32_t base,
                        const mpd_t *src, uint32_t *status);
 
+/* byte order of mpd_qimport_bytes() and mpd_qexport_bytes() */
+enum { MPD_LITTLE_ENDIAN, MPD_BIG_ENDIAN };
+
+void mpd_qimport_u64(mpd_t *result, const uint64_t *srcdata, size_t srclen,
+                     uint8_t srcsign,
+                     const mpd_context_t *ctx, uint32_t *status);
+void mpd_qimport_bytes(mpd_t *result, const uint8_t *srcdata, size_t srclen,
+                       uint8_t srcsign, int order,
+                       const mpd_context_t *ctx, uint32_t *status);
+size_t mpd_qexport_u64(uint64_t **rdata, size_t rlen, const mpd_t *src,
+                       uint32_t *status);
+size_t mpd_qexport_bytes(uint8_t *rdata, size_t rlen, int order,
+                         const mpd_t *src, uint32_t *status);
+
 
 /******************************************************************************/
 /*                           Signalling functions                             */
@@ -569,6 +583,10 @@ void mpd_import_u16(mpd_t *result, const uint16_t *srcdata, size_t srclen, uint8
 void mpd_import_u32(mpd_t *result, const uint32_t *srcdata, size_t srclen, uint8_t srcsign, uint32_t base, mpd_context_t *ctx);
 size_t mpd_export_u16(uint16_t **rdata, size_t rlen, uint32_t base, const mpd_t *src, mpd_context_t *ctx);
 size_t mpd_export_u32(uint32_t **rdata, size_t rlen, uint32_t base, const mpd_t *src, mpd_context_t *ctx);
+void mpd_import_u64(mpd_t *result, const uint64_t *srcdata, size_t srclen, uint8_t srcsign, mpd_context_t *ctx);
+void mpd_import_bytes(mpd_t *result, const uint8_t *srcdata, size_t srclen, uint8_t srcsign, int order, mpd_context_t *ctx);
+size_t mpd_export_u64(uint64_t **rdata, size_t rlen, const mpd_t *src, mpd_context_t *ctx);
+size_t mpd_export_bytes(uint8_t *rdata, size_t rlen, int order, const mpd_t *src, mpd_context_t *ctx);
 void mpd_finalize(mpd_t *result, mpd_context_t *ctx);
 int mpd_check_nan(mpd_t *result, const mpd_t *a, mpd_context_t *ctx);
 int mpd_check_nans(mpd_t *result, const mpd_t *a, const mpd_t *b, mpd_context_t *ctx);
@@ -812,6 +830,225 @@ void mpd_minalloc(mpd_t *result);
 int mpd_resize(mpd_t *result, mpd_ssize_t nwords, mpd_context_t *ctx);
 int mpd_resize_zero(mpd_t *result, mpd_ssize_t nwords, mpd_context_t *ctx);
 
+/*
+ * Decimal that carries a coefficient of up to MPD_INLINE_WORDS words in the
+ * same object, for use on the stack, in structs or in contiguous arrays.
+ * mpd_inline_init() returns the mpd_t to pass to all other functions. A
+ * coefficient that outgrows the inline words is allocated as usual and
+ * must be released with mpd_del(). The object must not be copied with
+ * memcpy() or by assignment after initialization. Returns NULL if
+ * MPD_MINALLOC exceeds MPD_INLINE_WORDS.
+ */
+#define MPD_INLINE_WORDS 4
+
+typedef struct mpd_inline_t {
+    mpd_t dec;
+    mpd_uint_t words[MPD_INLINE_WORDS];
+} mpd_inline_t;
+
+mpd_t *mpd_inline_init(mpd_inline_t *x);
+
+
+/******************************************************************************/
+/*                                  Arenas                                    */
+/******************************************************************************/
+
+/*
+ * While an arena is installed in the calling thread, decimals with a static
+ * coefficient (mpd_inline_t and the temporaries inside the library) that
+ * outgrow it take the larger coefficient from the arena by
+ * bump allocation instead of from mpd_mallocfunc. mpd_del() does not free
+ * such a coefficient: mpd_arena_pop() releases everything allocated since
+ * the matching mpd_arena_push() at once, and a decimal that was resized in
+ * the scope must not be used after that. Decimals from mpd_qnew() never use
+ * the arena. If the arena is full, the coefficient is allocated as usual.
+ */
+typedef struct mpd_arena_t mpd_arena_t;
+
+mpd_arena_t *mpd_qnew_arena(mpd_size_t nwords);
+void mpd_del_arena(mpd_arena_t *arena);
+mpd_arena_t *mpd_setarena(mpd_arena_t *arena);
+mpd_arena_t *mpd_getarena(void);
+mpd_size_t mpd_arena_push(mpd_arena_t *arena);
+void mpd_arena_pop(mpd_arena_t *arena, mpd_size_t scope);
+
+
+/******************************************************************************/
+/*                               Pool allocator                               */
+/******************************************************************************/
+
+/*
+ * Optional allocator for many threads. mpd_pool_install() replaces the
+ * memory handling functions with ones that serve blocks of up to 4096 bytes
+ * from power-of-two size classes, each thread caching free blocks, and
+ * passes larger blocks on to the previous functions. It must be called at
+ * program start, before anything is allocated. Threads should call
+ * mpd_pool_flush() before they exit, otherwise their cached blocks are lost.
+ */
+typedef struct mpd_pool_stats_t {
+    uint64_t allocs;     /* blocks served from the size classes */
+    uint64_t frees;      /* blocks returned to the size classes */
+    uint64_t large;      /* blocks passed on to the previous functions */
+    uint64_t depot_gets; /* caches refilled from the global depot */
+    uint64_t depot_puts; /* full caches moved to the global depot */
+    size_t slab_bytes;   /* memory obtained for the size classes */
+} mpd_pool_stats_t;
+
+void mpd_pool_install(void);
+void mpd_pool_flush(void);
+void mpd_pool_stats(mpd_pool_stats_t *stats);
+
+
+/******************************************************************************/
+/*                            Multiplication plans                            */
+/******************************************************************************/
+
+/*
+ * A plan holds the number theoretic transforms of a fixed operand, so that
+ * repeated multiplications by that operand skip its transforms. 'maxdigits'
+ * is the largest number of digits of the other operands. Products that do
+ * not fit the plan fall back to mpd_qmul().
+ */
+typedef struct mpd_mulplan_t mpd_mulplan_t;
+
+mpd_mulplan_t *mpd_qnew_mulplan(const mpd_t *v, mpd_ssize_t maxdigits, uint32_t *status);
+mpd_mulplan_t *mpd_new_mulplan(const mpd_t *v, mpd_ssize_t maxdigits, mpd_context_t *ctx);
+void mpd_del_mulplan(mpd_mulplan_t *plan);
+void mpd_qmul_plan(mpd_t *result, const mpd_t *a, const mpd_mulplan_t *plan, const mpd_context_t *ctx, uint32_t *status);
+void mpd_mul_plan(mpd_t *result, const mpd_t *a, const mpd_mulplan_t *plan, mpd_context_t *ctx);
+
+
+/******************************************************************************/
+/*                              Prepared divisors                             */
+/******************************************************************************/
+
+/*
+ * A prepared divisor holds precomputed data for repeated divisions by the
+ * same value: the inverse of a single word coefficient, the normalized
+ * coefficient for long division or a reciprocal for Newton division.
+ * 'maxprec' is the largest context precision of the divisions. Results are
+ * identical to those of mpd_qdiv(), mpd_qdivmod() and mpd_qrem().
+ */
+typedef struct mpd_divisor_t mpd_divisor_t;
+
+mpd_divisor_t *mpd_qnew_divisor(const mpd_t *b, mpd_ssize_t maxprec, uint32_t *status);
+mpd_divisor_t *mpd_new_divisor(const mpd_t *b, mpd_ssize_t maxprec, mpd_context_t *ctx);
+void mpd_del_divisor(mpd_divisor_t *dv);
+void mpd_qdiv_prepared(mpd_t *q, const mpd_t *a, const mpd_divisor_t *dv, const mpd_context_t *ctx, uint32_t *status);
+void mpd_qdivmod_prepared(mpd_t *q, mpd_t *r, const mpd_t *a, const mpd_divisor_t *dv, const mpd_context_t *ctx, uint32_t *status);
+void mpd_qrem_prepared(mpd_t *r, const mpd_t *a, const mpd_divisor_t *dv, const mpd_context_t *ctx, uint32_t *status);
+void mpd_div_prepared(mpd_t *q, const mpd_t *a, const mpd_divisor_t *dv, mpd_context_t *ctx);
+void mpd_divmod_prepared(mpd_t *q, mpd_t *r, const mpd_t *a, const mpd_divisor_t *dv, mpd_context_t *ctx);
+void mpd_rem_prepared(mpd_t *r, const mpd_t *a, const mpd_divisor_t *dv, mpd_context_t *ctx);
+
+
+/******************************************************************************/
+/*                          Transform parameter cache                         */
+/******************************************************************************/
+
+/*
+ * The tables of roots of unity for the number theoretic transform are kept
+ * in a process-wide LRU cache. The cache must be cleared before the memory
+ * handling functions above are replaced.
+ */
+typedef struct mpd_fntcache_stats_t {
+    uint64_t hits;      /* lookups served from the cache */
+    uint64_t misses;    /* lookups that computed a new table */
+    uint64_t evictions; /* tables dropped to stay below maxbytes */
+    size_t entries;     /* number of cached tables */
+    size_t bytes;       /* memory held by the cache */
+    size_t maxbytes;    /* memory limit of the cache */
+} mpd_fntcache_stats_t;
+
+void mpd_fntcache_setmax(size_t maxbytes);
+void mpd_fntcache_clear(void);
+void mpd_fntcache_stats(mpd_fntcache_stats_t *stats);
+
+
+/******************************************************************************/
+/*                               Constant cache                               */
+/******************************************************************************/
+
+/*
+ * ln(10) beyond the precision of the built-in table is kept in a process-wide
+ * cache at the highest precision computed so far. Like the transform cache,
+ * it must be cleared before the memory handling functions are replaced.
+ */
+void mpd_constcache_clear(void);
+
+
+/******************************************************************************/
+/*                              Multithreading                                */
+/******************************************************************************/
+
+/*
+ * Opt-in: compute the three modular convolutions of a large multiplication
+ * concurrently. The memory handling functions must be thread-safe. Like
+ * mpd_setminalloc(), this should be set at program start.
+ */
+void mpd_setfntparallel(int enable);
+int mpd_getfntparallel(void);
+
+/*
+ * Size of the worker pool used for the row and column passes of the
+ * six-step and four-step transforms. The default is 1 (no workers).
+ * Ranges smaller than the grain (in words) are not split. Both setters
+ * return 0 for invalid arguments.
+ */
+int mpd_setnumthreads(int nthreads);
+int mpd_getnumthreads(void);
+int mpd_setthreadgrain(mpd_size_t words);
+mpd_size_t mpd_getthreadgrain(void);
+
+
+/******************************************************************************/
+/*                                  Tuning                                    */
+/******************************************************************************/
+
+/*
+ * Crossover points between the multiplication, division, base conversion,
+ * exp, ln and sqrt algorithms, in words (of the working precision for exp,
+ * ln and sqrt).
+ * The defaults are measured on x86-64. The tuning program in
+ * examples/tune.d measures them on the current machine, except
+ * MPD_TUNE_LOWMEM_FNT_CUTOFF, which trades speed for memory, and writes a
+ * profile. With GCC and Clang, and in D programs that import dmpdecimal,
+ * the profile named by the MPD_TUNE_PROFILE environment variable is loaded
+ * at startup; otherwise, or for a different file, call
+ * mpd_load_tuneprofile(). Like mpd_setminalloc(), the values
+ * must not be changed while other threads are doing arithmetic.
+ *
+ * From MPD_TUNE_LOWMEM_FNT_CUTOFF, transform multiplications need about
+ * three quarters of the memory and are about ten percent slower. Set it
+ * to 0 before a large multiplication to always use the low-memory mode.
+ */
+enum {
+    MPD_TUNE_KARATSUBA_BASECASE,  /* schoolbook below this size             */
+    MPD_TUNE_KARATSUBA_CUTOFF,    /* Karatsuba up to this result size       */
+    MPD_TUNE_TOOM3_BASECASE,      /* Karatsuba below this size in Toom-3    */
+    MPD_TUNE_TOOM_FNT_CUTOFF,     /* Toom-3 up to this size, -1: automatic  */
+    MPD_TUNE_SIX_STEP_THRESHOLD,  /* six-step above this transform length   */
+    MPD_TUNE_POW2_CUTOFF,         /* only 2**n lengths up to this size      */
+    MPD_TUNE_NEWTONDIV_CUTOFF,    /* Newton division above this size        */
+    MPD_TUNE_PARALLEL_FNT_CUTOFF, /* parallel convolution from this length  */
+    MPD_TUNE_LOWMEM_FNT_CUTOFF,   /* less scratch memory from this length   */
+    MPD_TUNE_EXP_BSPLIT_CUTOFF,   /* binary splitting exp from this prec    */
+    MPD_TUNE_LN_AGM_CUTOFF,       /* AGM logarithm from this precision      */
+    MPD_TUNE_SQRT_COUPLED_CUTOFF, /* coupled sqrt iteration from this prec  */
+    MPD_TUNE_BZDIV_CUTOFF,        /* long division up to this divisor size  */
+    MPD_TUNE_BASECONV_CUTOFF,     /* split base conversions above this size */
+    MPD_TUNE_RECIPDIV_CUTOFF,     /* prepared reciprocal above this size    */
+    MPD_TUNE_GUARD
+};
+
+extern const char * const mpd_tune_string[MPD_TUNE_GUARD];
+
+int mpd_settune(int param, mpd_ssize_t value);
+mpd_ssize_t mpd_gettune(int param);
+void mpd_resettune(void);
+int mpd_load_tuneprofile(const char *path);
+int mpd_save_tuneprofile(const char *path);
+
 
 #ifdef __cplusplus
 } /* END extern "C" */
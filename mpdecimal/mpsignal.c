@@ -84,6 +84,46 @@ mpd_export_u32(uint32_t **rdata, size_t rlen, uint32_t base, const mpd_t *src,
     return n;
 }
 
+void
+mpd_import_u64(mpd_t *result, const uint64_t *srcdata, size_t srclen,
+               uint8_t srcsign, mpd_context_t *ctx)
+{
+    uint32_t status = 0;
+    mpd_qimport_u64(result, srcdata, srclen, srcsign, ctx, &status);
+    mpd_addstatus_raise(ctx, status);
+}
+
+void
+mpd_import_bytes(mpd_t *result, const uint8_t *srcdata, size_t srclen,
+                 uint8_t srcsign, int order, mpd_context_t *ctx)
+{
+    uint32_t status = 0;
+    mpd_qimport_bytes(result, srcdata, srclen, srcsign, order, ctx, &status);
+    mpd_addstatus_raise(ctx, status);
+}
+
+size_t
+mpd_export_u64(uint64_t **rdata, size_t rlen, const mpd_t *src,
+               mpd_context_t *ctx)
+{
+    size_t n;
+    uint32_t status = 0;
+    n = mpd_qexport_u64(rdata, rlen, src, &status);
+    mpd_addstatus_raise(ctx, status);
+    return n;
+}
+
+size_t
+mpd_export_bytes(uint8_t *rdata, size_t rlen, int order, const mpd_t *src,
+                 mpd_context_t *ctx)
+{
+    size_t n;
+    uint32_t status = 0;
+    n = mpd_qexport_bytes(rdata, rlen, order, src, &status);
+    mpd_addstatus_raise(ctx, status);
+    return n;
+}
+
 void
 mpd_finalize(mpd_t *result, mpd_context_t *ctx)
 {
@@ -619,6 +659,25 @@ mpd_div(mpd_t *q, const mpd_t *a, const mpd_t *b, mpd_context_t *ctx)
     mpd_addstatus_raise(ctx, status);
 }
 
+mpd_divisor_t *
+mpd_new_divisor(const mpd_t *b, mpd_ssize_t maxprec, mpd_context_t *ctx)
+{
+    uint32_t status = 0;
+    mpd_divisor_t *dv;
+    dv = mpd_qnew_divisor(b, maxprec, &status);
+    mpd_addstatus_raise(ctx, status);
+    return dv;
+}
+
+void
+mpd_div_prepared(mpd_t *q, const mpd_t *a, const mpd_divisor_t *dv,
+                 mpd_context_t *ctx)
+{
+    uint32_t status = 0;
+    mpd_qdiv_prepared(q, a, dv, ctx, &status);
+    mpd_addstatus_raise(ctx, status);
+}
+
 void
 mpd_div_ssize(mpd_t *result, const mpd_t *a, mpd_ssize_t b, mpd_context_t *ctx)
 {
@@ -679,6 +738,15 @@ mpd_divmod(mpd_t *q, mpd_t *r, const mpd_t *a, const mpd_t *b, mpd_context_t *ct
     mpd_addstatus_raise(ctx, status);
 }
 
+void
+mpd_divmod_prepared(mpd_t *q, mpd_t *r, const mpd_t *a,
+                    const mpd_divisor_t *dv, mpd_context_t *ctx)
+{
+    uint32_t status = 0;
+    mpd_qdivmod_prepared(q, r, a, dv, ctx, &status);
+    mpd_addstatus_raise(ctx, status);
+}
+
 void
 mpd_divint(mpd_t *q, const mpd_t *a, const mpd_t *b, mpd_context_t *ctx)
 {
@@ -768,6 +836,25 @@ mpd_mul(mpd_t *result, const mpd_t *a, const mpd_t *b, mpd_context_t *ctx)
     mpd_addstatus_raise(ctx, status);
 }
 
+mpd_mulplan_t *
+mpd_new_mulplan(const mpd_t *v, mpd_ssize_t maxdigits, mpd_context_t *ctx)
+{
+    uint32_t status = 0;
+    mpd_mulplan_t *plan;
+    plan = mpd_qnew_mulplan(v, maxdigits, &status);
+    mpd_addstatus_raise(ctx, status);
+    return plan;
+}
+
+void
+mpd_mul_plan(mpd_t *result, const mpd_t *a, const mpd_mulplan_t *plan,
+             mpd_context_t *ctx)
+{
+    uint32_t status = 0;
+    mpd_qmul_plan(result, a, plan, ctx, &status);
+    mpd_addstatus_raise(ctx, status);
+}
+
 void
 mpd_mul_ssize(mpd_t *result, const mpd_t *a, mpd_ssize_t b, mpd_context_t *ctx)
 {
@@ -901,6 +988,15 @@ mpd_rem(mpd_t *r, const mpd_t *a, const mpd_t *b, mpd_context_t *ctx)
     mpd_addstatus_raise(ctx, status);
 }
 
+void
+mpd_rem_prepared(mpd_t *r, const mpd_t *a, const mpd_divisor_t *dv,
+                 mpd_context_t *ctx)
+{
+    uint32_t status = 0;
+    mpd_qrem_prepared(r, a, dv, ctx, &status);
+    mpd_addstatus_raise(ctx, status);
+}
+
 void
 mpd_rem_near(mpd_t *r, const mpd_t *a, const mpd_t *b, mpd_context_t *ctx)
 {
@@ -0,0 +1,441 @@
+/*
+ * Copyright (c) 2026 Iain Buclaw.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#include <assert.h>
+#include <stdlib.h>
+
+#if defined(_WIN32)
+  #include <process.h>
+#endif
+
+#include "mpdecimal.h"
+#include "mpthread.h"
+
+
+/* Bignum: Helper threads for the transform code. */
+
+
+/* Minimum stack size for helper threads. The transforms keep sizeable
+   buffers on the stack, and some C libraries default to very small thread
+   stacks. Larger platform defaults are left alone. */
+#define MPD_THREAD_STACKSIZE (1024*1024)
+
+/* Opt-in parallel modular convolutions in _mpd_fntmul() */
+static int fnt_parallel = 0;
+
+void
+mpd_setfntparallel(int enable)
+{
+    fnt_parallel = !!enable;
+}
+
+int
+mpd_getfntparallel(void)
+{
+    return fnt_parallel;
+}
+
+
+struct mpd_task {
+    void (*func)(void *);
+    void *arg;
+};
+
+#if defined(_WIN32)
+typedef HANDLE mpd_thread_t;
+
+static unsigned __stdcall
+_mpd_thread_start(void *arg)
+{
+    struct mpd_task *task = arg;
+    task->func(task->arg);
+    mpd_pool_flush();
+    return 0;
+}
+
+static int
+_mpd_thread_create(mpd_thread_t *thread, struct mpd_task *task)
+{
+    uintptr_t h;
+
+    h = _beginthreadex(NULL, MPD_THREAD_STACKSIZE, _mpd_thread_start, task,
+                       0, NULL);
+    if (h == 0) {
+        return 0;
+    }
+    *thread = (HANDLE)h;
+    return 1;
+}
+
+static void
+_mpd_thread_join(mpd_thread_t thread)
+{
+    WaitForSingleObject(thread, INFINITE);
+    CloseHandle(thread);
+}
+
+static void
+_mpd_thread_detach(mpd_thread_t thread)
+{
+    CloseHandle(thread);
+}
+#else
+typedef pthread_t mpd_thread_t;
+
+static void *
+_mpd_thread_start(void *arg)
+{
+    struct mpd_task *task = arg;
+    task->func(task->arg);
+    mpd_pool_flush();
+    return NULL;
+}
+
+static int
+_mpd_thread_create(mpd_thread_t *thread, struct mpd_task *task)
+{
+    pthread_attr_t attr;
+    size_t stacksize;
+    int ret;
+
+    if (pthread_attr_init(&attr) != 0) {
+        return 0;
+    }
+    if (pthread_attr_getstacksize(&attr, &stacksize) != 0 ||
+        stacksize < MPD_THREAD_STACKSIZE) {
+        (void)pthread_attr_setstacksize(&attr, MPD_THREAD_STACKSIZE);
+    }
+    ret = pthread_create(thread, &attr, _mpd_thread_start, task);
+    (void)pthread_attr_destroy(&attr);
+
+    return ret == 0;
+}
+
+static void
+_mpd_thread_join(mpd_thread_t thread)
+{
+    (void)pthread_join(thread, NULL);
+}
+
+static void
+_mpd_thread_detach(mpd_thread_t thread)
+{
+    (void)pthread_detach(thread);
+}
+#endif
+
+/*
+ * Call func(args[i]) for i in [0, ntasks). Task 0 runs in the calling thread,
+ * the others in helper threads. If a helper thread cannot be created, the
+ * task is run in the calling thread instead, so the function always
+ * completes all tasks.
+ */
+void
+_mpd_run_tasks(void (*func)(void *), void *args[], int ntasks)
+{
+    struct mpd_task task[MPD_MAX_TASKS];
+    mpd_thread_t thread[MPD_MAX_TASKS];
+    int started[MPD_MAX_TASKS];
+    int i;
+
+    assert(0 < ntasks && ntasks <= MPD_MAX_TASKS);
+
+    for (i = 1; i < ntasks; i++) {
+        task[i].func = func;
+        task[i].arg = args[i];
+        started[i] = _mpd_thread_create(&thread[i], &task[i]);
+    }
+
+    func(args[0]);
+
+    for (i = 1; i < ntasks; i++) {
+        if (started[i]) {
+            _mpd_thread_join(thread[i]);
+        }
+        else {
+            func(args[i]);
+        }
+    }
+}
+
+
+
+/******************************************************************************/
+/*                                Thread pool                                 */
+/******************************************************************************/
+
+/*
+ * A parallel loop over [0, count) is posted as a job. The range is split
+ * into one part per slot. The calling thread owns slot 0 and pool workers
+ * claim the remaining slots. Each participant works through its part in
+ * chunks of 'grain' items. A participant that runs out of work steals the
+ * upper half of the largest part that is left, including the parts of
+ * slots that no worker has claimed yet.
+ *
+ * All bookkeeping happens under a single lock. A chunk covers at least
+ * 'pool_grain' words of transform data, so the lock is rarely contended.
+ */
+#define MPD_MAX_THREADS 256
+#define MPD_THREADGRAIN_DEFAULT 16384
+
+struct mpd_job {
+    struct mpd_job *next;
+    void (*func)(void *, mpd_size_t, mpd_size_t);
+    void *arg;
+    mpd_size_t grain;
+    mpd_size_t pending;   /* items that have not been processed */
+    int nslots;
+    int joined;           /* number of claimed slots */
+    int active;           /* participants currently working on the job */
+    mpd_size_t lo[MPD_MAX_THREADS];
+    mpd_size_t hi[MPD_MAX_THREADS];
+};
+
+static mpd_mutex_t pool_lock = MPD_MUTEX_INITIALIZER;
+static mpd_cond_t pool_work = MPD_COND_INITIALIZER;
+static mpd_cond_t pool_done = MPD_COND_INITIALIZER;
+static struct mpd_job *pool_jobs = NULL;
+static int pool_nthreads = 1;     /* including the calling thread */
+static int pool_nworkers = 0;     /* workers that have been started */
+static mpd_size_t pool_grain = MPD_THREADGRAIN_DEFAULT;
+
+/* Set the number of threads (including the calling thread) that the matrix
+   transforms may use. Return 0 for an invalid value, 1 otherwise. */
+int
+mpd_setnumthreads(int nthreads)
+{
+    if (nthreads < 1 || nthreads > MPD_MAX_THREADS) {
+        return 0;
+    }
+
+    mpd_mutex_lock(&pool_lock);
+    pool_nthreads = nthreads;
+    mpd_mutex_unlock(&pool_lock);
+    return 1;
+}
+
+int
+mpd_getnumthreads(void)
+{
+    int nthreads;
+
+    mpd_mutex_lock(&pool_lock);
+    nthreads = pool_nthreads;
+    mpd_mutex_unlock(&pool_lock);
+    return nthreads;
+}
+
+/* Set the minimum amount of work (in words of transform data) that is
+   handed to a thread at once. Return 0 for an invalid value, 1 otherwise. */
+int
+mpd_setthreadgrain(mpd_size_t words)
+{
+    if (words == 0) {
+        return 0;
+    }
+
+    mpd_mutex_lock(&pool_lock);
+    pool_grain = words;
+    mpd_mutex_unlock(&pool_lock);
+    return 1;
+}
+
+mpd_size_t
+mpd_getthreadgrain(void)
+{
+    mpd_size_t words;
+
+    mpd_mutex_lock(&pool_lock);
+    words = pool_grain;
+    mpd_mutex_unlock(&pool_lock);
+    return words;
+}
+
+/* Requires pool_lock. */
+static int
+_mpd_job_has_work(const struct mpd_job *job)
+{
+    int i;
+
+    for (i = 0; i < job->nslots; i++) {
+        if (job->lo[i] < job->hi[i]) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/* Requires pool_lock. Process items of 'job' as participant 'slot'. The
+   lock is released while the loop body runs. */
+static void
+_mpd_job_run(struct mpd_job *job, int slot)
+{
+    mpd_size_t lo, hi, n, best;
+    int i, victim;
+
+    for (;;) {
+        if (job->lo[slot] == job->hi[slot]) {
+            victim = -1; best = 0;
+            for (i = 0; i < job->nslots; i++) {
+                n = job->hi[i] - job->lo[i];
+                if (n > best) {
+                    best = n;
+                    victim = i;
+                }
+            }
+            if (victim < 0) {
+                return;
+            }
+            n = (best > job->grain) ? best/2 : best;
+            job->hi[slot] = job->hi[victim];
+            job->lo[slot] = job->hi[victim] = job->hi[victim] - n;
+        }
+
+        lo = job->lo[slot];
+        n = job->hi[slot] - lo;
+        hi = lo + ((n > job->grain) ? job->grain : n);
+        job->lo[slot] = hi;
+
+        mpd_mutex_unlock(&pool_lock);
+        job->func(job->arg, lo, hi);
+        mpd_mutex_lock(&pool_lock);
+
+        job->pending -= hi - lo;
+    }
+}
+
+static void
+_mpd_pool_main(void *arg)
+{
+    struct mpd_job *job;
+    int slot, flushed = 1;
+
+    (void)arg;
+#ifdef PPRO
+    (void)mpd_set_fenv();
+#endif
+
+    mpd_mutex_lock(&pool_lock);
+    for (;;) {
+        for (job = pool_jobs; job != NULL; job = job->next) {
+            if (job->joined < job->nslots && _mpd_job_has_work(job)) {
+                break;
+            }
+        }
+        if (job == NULL) {
+            if (!flushed) {
+                /* The worker never exits: hand back its cached blocks
+                   before going idle, then look for work again. */
+                mpd_mutex_unlock(&pool_lock);
+                mpd_pool_flush();
+                mpd_mutex_lock(&pool_lock);
+                flushed = 1;
+                continue;
+            }
+            mpd_cond_wait(&pool_work, &pool_lock);
+            continue;
+        }
+
+        flushed = 0;
+        slot = job->joined++;
+        job->active++;
+        _mpd_job_run(job, slot);
+        job->active--;
+        mpd_cond_broadcast(&pool_done);
+    }
+}
+
+static struct mpd_task pool_task = {_mpd_pool_main, NULL};
+
+/*
+ * Call func(arg, lo, hi) for consecutive subranges that cover [0, count).
+ * 'itemsize' is the number of words an item touches; it determines how
+ * many items make up one unit of work. The function returns when all items
+ * have been processed. Thread creation failures only reduce parallelism.
+ */
+void
+_mpd_parallel_for(mpd_size_t count, mpd_size_t itemsize,
+                  void (*func)(void *, mpd_size_t, mpd_size_t),
+                  void *arg)
+{
+    struct mpd_job job;
+    struct mpd_job **pp;
+    mpd_thread_t thread;
+    mpd_size_t grain, lo, part;
+    int nthreads, i;
+
+    assert(itemsize > 0);
+
+    mpd_mutex_lock(&pool_lock);
+    nthreads = pool_nthreads;
+    grain = pool_grain / itemsize;
+    if (grain == 0) grain = 1;
+
+    if (nthreads == 1 || count <= grain) {
+        mpd_mutex_unlock(&pool_lock);
+        func(arg, 0, count);
+        return;
+    }
+
+    while (pool_nworkers < nthreads-1) {
+        if (!_mpd_thread_create(&thread, &pool_task)) {
+            break;
+        }
+        _mpd_thread_detach(thread);
+        pool_nworkers++;
+    }
+
+    job.func = func;
+    job.arg = arg;
+    job.grain = grain;
+    job.pending = count;
+    job.nslots = (count/grain < (mpd_size_t)nthreads) ? (int)(count/grain)
+                                                      : nthreads;
+    for (i = 0, lo = 0; i < job.nslots; i++) {
+        part = count / job.nslots + ((mpd_size_t)i < count % job.nslots);
+        job.lo[i] = lo;
+        job.hi[i] = lo + part;
+        lo += part;
+    }
+    job.joined = 1;
+    job.active = 1;
+    job.next = pool_jobs;
+    pool_jobs = &job;
+    mpd_cond_broadcast(&pool_work);
+
+    _mpd_job_run(&job, 0);
+    job.active--;
+    while (job.pending > 0 || job.active > 0) {
+        mpd_cond_wait(&pool_done, &pool_lock);
+    }
+
+    for (pp = &pool_jobs; *pp != &job; pp = &(*pp)->next)
+        ;
+    *pp = job.next;
+    mpd_mutex_unlock(&pool_lock);
+}
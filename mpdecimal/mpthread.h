@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2026 Iain Buclaw.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#ifndef LIBMPDEC_MPTHREAD_H_
+#define LIBMPDEC_MPTHREAD_H_
+
+
+#include "mpdecimal.h"
+
+#if defined(_WIN32)
+  #include <windows.h>
+#else
+  #include <pthread.h>
+#endif
+
+
+/* Internal header file: all symbols have local scope in the DSO */
+MPD_PRAGMA(MPD_HIDE_SYMBOLS_START)
+
+
+/*
+ * Minimal locking primitives for the few pieces of process-wide state
+ * (caches) in the library. The mutexes are statically initialized, so
+ * no library initialization function is required.
+ */
+#if defined(_WIN32)
+typedef SRWLOCK mpd_mutex_t;
+typedef CONDITION_VARIABLE mpd_cond_t;
+#define MPD_MUTEX_INITIALIZER SRWLOCK_INIT
+#define MPD_COND_INITIALIZER CONDITION_VARIABLE_INIT
+
+static inline void
+mpd_mutex_lock(mpd_mutex_t *m)
+{
+    AcquireSRWLockExclusive(m);
+}
+
+static inline void
+mpd_mutex_unlock(mpd_mutex_t *m)
+{
+    ReleaseSRWLockExclusive(m);
+}
+
+static inline void
+mpd_cond_wait(mpd_cond_t *c, mpd_mutex_t *m)
+{
+    SleepConditionVariableSRW(c, m, INFINITE, 0);
+}
+
+static inline void
+mpd_cond_broadcast(mpd_cond_t *c)
+{
+    WakeAllConditionVariable(c);
+}
+#else
+typedef pthread_mutex_t mpd_mutex_t;
+typedef pthread_cond_t mpd_cond_t;
+#define MPD_MUTEX_INITIALIZER PTHREAD_MUTEX_INITIALIZER
+#define MPD_COND_INITIALIZER PTHREAD_COND_INITIALIZER
+
+static inline void
+mpd_mutex_lock(mpd_mutex_t *m)
+{
+    if (pthread_mutex_lock(m) != 0) {
+        abort(); /* GCOV_NOT_REACHED */
+    }
+}
+
+static inline void
+mpd_mutex_unlock(mpd_mutex_t *m)
+{
+    if (pthread_mutex_unlock(m) != 0) {
+        abort(); /* GCOV_NOT_REACHED */
+    }
+}
+
+static inline void
+mpd_cond_wait(mpd_cond_t *c, mpd_mutex_t *m)
+{
+    if (pthread_cond_wait(c, m) != 0) {
+        abort(); /* GCOV_NOT_REACHED */
+    }
+}
+
+static inline void
+mpd_cond_broadcast(mpd_cond_t *c)
+{
+    if (pthread_cond_broadcast(c) != 0) {
+        abort(); /* GCOV_NOT_REACHED */
+    }
+}
+#endif
+
+
+/* Storage class for per-thread state */
+#if defined(_MSC_VER)
+  #define MPD_THREAD_LOCAL __declspec(thread)
+#elif defined(__GNUC__)
+  #define MPD_THREAD_LOCAL __thread
+#else
+  #define MPD_THREAD_LOCAL _Thread_local
+#endif
+
+
+/* Helper threads */
+#define MPD_MAX_TASKS 3
+
+void _mpd_run_tasks(void (*func)(void *), void *args[], int ntasks);
+
+/* Thread pool for the row and column passes of the matrix transforms */
+void _mpd_parallel_for(mpd_size_t count, mpd_size_t itemsize,
+                       void (*func)(void *, mpd_size_t, mpd_size_t),
+                       void *arg);
+
+#ifdef PPRO
+/* The x87 control word is per thread (mpdecimal.c). */
+unsigned int mpd_set_fenv(void);
+void mpd_restore_fenv(unsigned int cw);
+#endif
+
+
+MPD_PRAGMA(MPD_HIDE_SYMBOLS_END) /* restore previous scope rules */
+
+
+#endif /* LIBMPDEC_MPTHREAD_H_ */
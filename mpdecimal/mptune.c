@@ -0,0 +1,229 @@
+/*
+ * Copyright (c) 2026 Iain Buclaw.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mpdecimal.h"
+#include "mptune.h"
+
+
+/* Bignum: Run-time tunable crossover points between the algorithms. */
+
+
+struct tune_limits {
+    mpd_ssize_t dflt;
+    mpd_ssize_t min;
+    mpd_ssize_t max;
+};
+
+/*
+ * Default, minimum and maximum of each parameter, in the order of the
+ * MPD_TUNE_* enum. Both tables below are generated from this list.
+ */
+#define TUNE_PARAMS(X) \
+    X(KARATSUBA_BASECASE, 16, 4, 4096) \
+    X(KARATSUBA_CUTOFF, 1024, 0, MPD_SSIZE_MAX) \
+    X(TOOM3_BASECASE, 192, 16, MPD_SSIZE_MAX) \
+    X(TOOM_FNT_CUTOFF, -1, -1, MPD_SSIZE_MAX) \
+    X(SIX_STEP_THRESHOLD, 4096, 16, MPD_MAXTRANSFORM_2N) \
+    X(POW2_CUTOFF, 4096, 64, MPD_MAXTRANSFORM_2N) \
+    X(NEWTONDIV_CUTOFF, 32768, 64, MPD_SSIZE_MAX) \
+    X(PARALLEL_FNT_CUTOFF, 4096, 0, MPD_SSIZE_MAX) \
+    X(LOWMEM_FNT_CUTOFF, 16777216, 0, MPD_SSIZE_MAX) \
+    X(EXP_BSPLIT_CUTOFF, 10, 0, MPD_SSIZE_MAX) \
+    X(LN_AGM_CUTOFF, 640, 0, MPD_SSIZE_MAX) \
+    X(SQRT_COUPLED_CUTOFF, 3, 0, MPD_SSIZE_MAX) \
+    X(BZDIV_CUTOFF, 32, 8, MPD_SSIZE_MAX) \
+    X(BASECONV_CUTOFF, 96, 8, MPD_SSIZE_MAX) \
+    X(RECIPDIV_CUTOFF, 512, 1, MPD_SSIZE_MAX)
+
+#define TUNE_LIMITS(name, dflt, min, max) {dflt, min, max},
+#define TUNE_DEFAULT(name, dflt, min, max) dflt,
+
+static const struct tune_limits tune_limits[MPD_TUNE_GUARD] = {
+    TUNE_PARAMS(TUNE_LIMITS)
+};
+
+/* Current values, initialized to the defaults. */
+mpd_ssize_t _mpd_tune[MPD_TUNE_GUARD] = {
+    TUNE_PARAMS(TUNE_DEFAULT)
+};
+
+
+/* Set a parameter. Return 0 for an invalid parameter or value, 1 otherwise. */
+int
+mpd_settune(int param, mpd_ssize_t value)
+{
+    if (param < 0 || param >= MPD_TUNE_GUARD) {
+        return 0;
+    }
+    if (value < tune_limits[param].min || value > tune_limits[param].max) {
+        return 0;
+    }
+
+    _mpd_tune[param] = value;
+    return 1;
+}
+
+/* Return the value of a parameter, -1 for an invalid parameter. */
+mpd_ssize_t
+mpd_gettune(int param)
+{
+    if (param < 0 || param >= MPD_TUNE_GUARD) {
+        return -1;
+    }
+
+    return _mpd_tune[param];
+}
+
+/* Restore the built-in defaults. */
+void
+mpd_resettune(void)
+{
+    int i;
+
+    for (i = 0; i < MPD_TUNE_GUARD; i++) {
+        _mpd_tune[i] = tune_limits[i].dflt;
+    }
+}
+
+static int
+tune_lookup(const char *name)
+{
+    int i;
+
+    for (i = 0; i < MPD_TUNE_GUARD; i++) {
+        if (strcmp(name, mpd_tune_string[i]) == 0) {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+/*
+ * Read a profile. Each line holds a parameter name from mpd_tune_string
+ * and a value, separated by whitespace. Empty lines and lines starting
+ * with '#' are ignored. Parameters that are not listed keep their values.
+ * Return 1 on success. Return 0 if the file cannot be read or contains an
+ * invalid line, in which case no parameter is changed.
+ */
+int
+mpd_load_tuneprofile(const char *path)
+{
+    mpd_ssize_t values[MPD_TUNE_GUARD];
+    char line[256], name[64], rest[2];
+    long long v;
+    FILE *fp;
+    int param, n, i;
+    int ok = 1;
+
+    if ((fp = fopen(path, "r")) == NULL) {
+        return 0;
+    }
+
+    memcpy(values, _mpd_tune, sizeof values);
+
+    while (fgets(line, sizeof line, fp) != NULL) {
+        if (strchr(line, '\n') == NULL && !feof(fp)) {
+            ok = 0; /* line too long */
+            break;
+        }
+        n = sscanf(line, "%63s %lld %1s", name, &v, rest);
+        if (n <= 0 || name[0] == '#') {
+            continue;
+        }
+        if (n != 2 || (param = tune_lookup(name)) < 0 ||
+            v < tune_limits[param].min || v > tune_limits[param].max) {
+            ok = 0;
+            break;
+        }
+        values[param] = (mpd_ssize_t)v;
+    }
+
+    if (ferror(fp)) {
+        ok = 0;
+    }
+    fclose(fp);
+
+    if (ok) {
+        for (i = 0; i < MPD_TUNE_GUARD; i++) {
+            _mpd_tune[i] = values[i];
+        }
+    }
+
+    return ok;
+}
+
+/* Write all parameters to a profile. Return 1 on success, 0 otherwise. */
+int
+mpd_save_tuneprofile(const char *path)
+{
+    FILE *fp;
+    int i;
+    int ok = 1;
+
+    if ((fp = fopen(path, "w")) == NULL) {
+        return 0;
+    }
+
+    if (fprintf(fp, "# libmpdec %s tuning profile\n", mpd_version()) < 0) {
+        ok = 0;
+    }
+    for (i = 0; ok && i < MPD_TUNE_GUARD; i++) {
+        if (fprintf(fp, "%s %lld\n", mpd_tune_string[i],
+                    (long long)_mpd_tune[i]) < 0) {
+            ok = 0;
+        }
+    }
+
+    if (fclose(fp) != 0) {
+        ok = 0;
+    }
+
+    return ok;
+}
+
+
+/*
+ * Load the profile named by the MPD_TUNE_PROFILE environment variable at
+ * startup. With ImportC, the constructor of the dmpdecimal module does
+ * this. Other compilers have to call mpd_load_tuneprofile() explicitly.
+ */
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(__IMPORTC__)
+static void __attribute__((constructor))
+_mpd_tune_init(void)
+{
+    const char *path = getenv("MPD_TUNE_PROFILE");
+
+    if (path != NULL && *path != '\0') {
+        (void)mpd_load_tuneprofile(path);
+    }
+}
+#endif
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2026 Iain Buclaw.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+
+#ifndef LIBMPDEC_MPTUNE_H_
+#define LIBMPDEC_MPTUNE_H_
+
+
+#include "mpdecimal.h"
+
+
+/* Internal header file: all symbols have local scope in the DSO */
+MPD_PRAGMA(MPD_HIDE_SYMBOLS_START)
+
+
+/*
+ * Current values of the crossover points, indexed by MPD_TUNE_*. They are
+ * read without locking: the parameters may only be changed while no other
+ * thread is doing arithmetic.
+ */
+extern mpd_ssize_t _mpd_tune[MPD_TUNE_GUARD];
+
+#define MPD_KARATSUBA_BASECASE ((mpd_size_t)_mpd_tune[MPD_TUNE_KARATSUBA_BASECASE])
+#define MPD_KARATSUBA_CUTOFF ((mpd_size_t)_mpd_tune[MPD_TUNE_KARATSUBA_CUTOFF])
+#define MPD_TOOM3_BASECASE ((mpd_size_t)_mpd_tune[MPD_TUNE_TOOM3_BASECASE])
+#define MPD_SIX_STEP_THRESHOLD ((mpd_size_t)_mpd_tune[MPD_TUNE_SIX_STEP_THRESHOLD])
+#define MPD_POW2_CUTOFF ((mpd_size_t)_mpd_tune[MPD_TUNE_POW2_CUTOFF])
+#define MPD_NEWTONDIV_CUTOFF _mpd_tune[MPD_TUNE_NEWTONDIV_CUTOFF]
+#define MPD_PARALLEL_FNT_CUTOFF ((mpd_size_t)_mpd_tune[MPD_TUNE_PARALLEL_FNT_CUTOFF])
+#define MPD_LOWMEM_FNT_CUTOFF ((mpd_size_t)_mpd_tune[MPD_TUNE_LOWMEM_FNT_CUTOFF])
+#define MPD_EXP_BSPLIT_CUTOFF _mpd_tune[MPD_TUNE_EXP_BSPLIT_CUTOFF]
+#define MPD_LN_AGM_CUTOFF _mpd_tune[MPD_TUNE_LN_AGM_CUTOFF]
+#define MPD_SQRT_COUPLED_CUTOFF _mpd_tune[MPD_TUNE_SQRT_COUPLED_CUTOFF]
+#define MPD_BZDIV_CUTOFF _mpd_tune[MPD_TUNE_BZDIV_CUTOFF]
+#define MPD_BASECONV_CUTOFF _mpd_tune[MPD_TUNE_BASECONV_CUTOFF]
+#define MPD_RECIPDIV_CUTOFF ((mpd_size_t)_mpd_tune[MPD_TUNE_RECIPDIV_CUTOFF])
+
+
+MPD_PRAGMA(MPD_HIDE_SYMBOLS_END) /* restore previous scope rules */
+
+
+#endif /* LIBMPDEC_MPTUNE_H_ */
@@ -31,6 +31,7 @@
 #include "bits.h"
 #include "numbertheory.h"
 #include "mpdecimal.h"
+#include "mpthread.h"
 #include "umodarith.h"
 
 
@@ -98,6 +99,11 @@ _mpd_init_fnt_params(mpd_size_t n, int sign, int modnum)
     tparams->modnum = modnum;
     tparams->modulus = umod;
     tparams->kernel = kernel;
+    tparams->prev = tparams->next = NULL;
+    tparams->n = n;
+    tparams->sign = sign;
+    tparams->cached = 0;
+    tparams->refcount = 1;
 
     /* wtable[] := w**0, w**1, ..., w**(nhalf-1) */
     w = 1;
@@ -127,3 +133,197 @@ _mpd_init_w3table(mpd_uint_t w3table[3], int sign, int modnum)
     w3table[1] = kernel;
     w3table[2] = POWMOD(kernel, 2);
 }
+
+
+/*
+ * Process-wide cache of transform parameters. Multiplications of similar
+ * size use the same few transform lengths over and over again, so the wtable
+ * of each (n, sign, modnum) triple is computed once and kept in a list that
+ * is ordered from the most recently to the least recently used entry.
+ *
+ * Entries are pinned by their reference count while a transform uses them.
+ * If the cache exceeds 'fntcache_maxbytes', unpinned entries are evicted
+ * from the tail of the list. Parameters that do not fit into the cache at
+ * all are handed out uncached and freed on release.
+ */
+#define MPD_FNTCACHE_DEFAULT (4*1024*1024)
+
+static mpd_mutex_t fntcache_lock = MPD_MUTEX_INITIALIZER;
+static struct fnt_params *fntcache_head = NULL;
+static struct fnt_params *fntcache_tail = NULL;
+static size_t fntcache_maxbytes = MPD_FNTCACHE_DEFAULT;
+static size_t fntcache_bytes = 0;
+static size_t fntcache_entries = 0;
+static uint64_t fntcache_hits = 0;
+static uint64_t fntcache_misses = 0;
+static uint64_t fntcache_evictions = 0;
+
+static inline size_t
+fntcache_size(const struct fnt_params *tparams)
+{
+    return sizeof *tparams + (tparams->n/2) * sizeof *tparams->wtable;
+}
+
+static void
+fntcache_unlink(struct fnt_params *tparams)
+{
+    if (tparams->prev) tparams->prev->next = tparams->next;
+    else fntcache_head = tparams->next;
+
+    if (tparams->next) tparams->next->prev = tparams->prev;
+    else fntcache_tail = tparams->prev;
+
+    tparams->prev = tparams->next = NULL;
+}
+
+static void
+fntcache_push_front(struct fnt_params *tparams)
+{
+    tparams->prev = NULL;
+    tparams->next = fntcache_head;
+    if (fntcache_head) fntcache_head->prev = tparams;
+    else fntcache_tail = tparams;
+    fntcache_head = tparams;
+}
+
+/* Evict unpinned entries until the cache holds at most maxbytes. */
+static void
+fntcache_evict(size_t maxbytes)
+{
+    struct fnt_params *tparams, *prev;
+
+    for (tparams = fntcache_tail;
+         tparams != NULL && fntcache_bytes > maxbytes;
+         tparams = prev) {
+        prev = tparams->prev;
+        if (tparams->refcount == 0) {
+            fntcache_unlink(tparams);
+            fntcache_bytes -= fntcache_size(tparams);
+            fntcache_entries--;
+            fntcache_evictions++;
+            mpd_free(tparams);
+        }
+    }
+}
+
+/* Requires fntcache_lock. Return a pinned entry or NULL. */
+static struct fnt_params *
+fntcache_lookup(mpd_size_t n, int sign, int modnum)
+{
+    struct fnt_params *tparams;
+
+    for (tparams = fntcache_head; tparams != NULL; tparams = tparams->next) {
+        if (tparams->n == n && tparams->sign == sign &&
+            tparams->modnum == modnum) {
+            tparams->refcount++;
+            if (tparams != fntcache_head) {
+                fntcache_unlink(tparams);
+                fntcache_push_front(tparams);
+            }
+            return tparams;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Return transform parameters for (n, sign, modnum), either from the cache
+ * or freshly computed. The parameters must be returned with
+ * _mpd_release_fnt_params(). Return NULL on malloc failure.
+ */
+struct fnt_params *
+_mpd_get_fnt_params(mpd_size_t n, int sign, int modnum)
+{
+    struct fnt_params *tparams, *t;
+
+    mpd_mutex_lock(&fntcache_lock);
+    tparams = fntcache_lookup(n, sign, modnum);
+    if (tparams != NULL) {
+        fntcache_hits++;
+        mpd_mutex_unlock(&fntcache_lock);
+        return tparams;
+    }
+    fntcache_misses++;
+    mpd_mutex_unlock(&fntcache_lock);
+
+    /* The table is computed without holding the lock. */
+    if ((tparams = _mpd_init_fnt_params(n, sign, modnum)) == NULL) {
+        return NULL;
+    }
+
+    mpd_mutex_lock(&fntcache_lock);
+    if (fntcache_size(tparams) <= fntcache_maxbytes) {
+        /* Another thread may have inserted the same entry meanwhile. */
+        t = fntcache_lookup(n, sign, modnum);
+        if (t != NULL) {
+            mpd_mutex_unlock(&fntcache_lock);
+            mpd_free(tparams);
+            return t;
+        }
+        tparams->cached = 1;
+        fntcache_push_front(tparams);
+        fntcache_bytes += fntcache_size(tparams);
+        fntcache_entries++;
+        fntcache_evict(fntcache_maxbytes);
+    }
+    mpd_mutex_unlock(&fntcache_lock);
+
+    return tparams;
+}
+
+/* Release parameters obtained from _mpd_get_fnt_params(). */
+void
+_mpd_release_fnt_params(struct fnt_params *tparams)
+{
+    /* 'cached' does not change while the caller holds a reference. */
+    if (!tparams->cached) {
+        mpd_free(tparams);
+        return;
+    }
+
+    mpd_mutex_lock(&fntcache_lock);
+    assert(tparams->refcount > 0);
+    tparams->refcount--;
+    if (fntcache_bytes > fntcache_maxbytes) {
+        fntcache_evict(fntcache_maxbytes);
+    }
+    mpd_mutex_unlock(&fntcache_lock);
+}
+
+
+/******************************************************************************/
+/*                       Transform cache: public API                          */
+/******************************************************************************/
+
+/* Set the memory limit of the transform cache. 0 disables the cache. */
+void
+mpd_fntcache_setmax(size_t maxbytes)
+{
+    mpd_mutex_lock(&fntcache_lock);
+    fntcache_maxbytes = maxbytes;
+    fntcache_evict(fntcache_maxbytes);
+    mpd_mutex_unlock(&fntcache_lock);
+}
+
+/* Release all cached parameters that are not currently in use. */
+void
+mpd_fntcache_clear(void)
+{
+    mpd_mutex_lock(&fntcache_lock);
+    fntcache_evict(0);
+    mpd_mutex_unlock(&fntcache_lock);
+}
+
+void
+mpd_fntcache_stats(mpd_fntcache_stats_t *stats)
+{
+    mpd_mutex_lock(&fntcache_lock);
+    stats->hits = fntcache_hits;
+    stats->misses = fntcache_misses;
+    stats->evictions = fntcache_evictions;
+    stats->entries = fntcache_entries;
+    stats->bytes = fntcache_bytes;
+    stats->maxbytes = fntcache_maxbytes;
+    mpd_mutex_unlock(&fntcache_lock);
+}
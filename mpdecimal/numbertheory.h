@@ -42,12 +42,21 @@ struct fnt_params {
     int modnum;
     mpd_uint_t modulus;
     mpd_uint_t kernel;
+    /* bookkeeping for the transform cache */
+    struct fnt_params *prev;
+    struct fnt_params *next;
+    mpd_size_t n;
+    int sign;
+    int cached;
+    mpd_size_t refcount;
     mpd_uint_t wtable[];
 };
 
 
 mpd_uint_t _mpd_getkernel(mpd_uint_t n, int sign, int modnum);
 struct fnt_params *_mpd_init_fnt_params(mpd_size_t n, int sign, int modnum);
+struct fnt_params *_mpd_get_fnt_params(mpd_size_t n, int sign, int modnum);
+void _mpd_release_fnt_params(struct fnt_params *tparams);
 void _mpd_init_w3table(mpd_uint_t w3table[3], int sign, int modnum);
 
 
@@ -33,6 +33,7 @@
 #include "difradix2.h"
 #include "numbertheory.h"
 #include "mpdecimal.h"
+#include "mpthread.h"
 #include "sixstep.h"
 #include "transpose.h"
 #include "umodarith.h"
@@ -42,21 +43,86 @@
    form 2**n (See literature/six-step.txt). */
 
 
-/* forward transform with sign = -1 */
-int
-six_step_fnt(mpd_uint_t *a, mpd_size_t n, int modnum)
+/* Row transforms and twiddle multiplications are independent for each
+   row, so they are distributed over the thread pool. */
+struct rows_args {
+    mpd_uint_t *a;
+    mpd_size_t cols;
+    struct fnt_params *tparams;  /* row transforms */
+    mpd_uint_t kernel;           /* twiddle multiplications */
+    int modnum;
+};
+
+/* Length 'cols' transform on rows [lo, hi). */
+static void
+_fnt_rows(void *arg, mpd_size_t lo, mpd_size_t hi)
 {
-    struct fnt_params *tparams;
-    mpd_size_t log2n, C, R;
-    mpd_uint_t kernel;
+    struct rows_args *args = arg;
+    mpd_size_t cols = args->cols;
+    mpd_uint_t *x;
+
+    for (x = args->a+lo*cols; x < args->a+hi*cols; x += cols) {
+        fnt_dif2(x, cols, args->tparams);
+    }
+}
+
+/* Multiply each matrix element (addressed by i*cols+k) by r**(i*k). */
+static void
+_twiddle_rows(void *arg, mpd_size_t lo, mpd_size_t hi)
+{
+    struct rows_args *args = arg;
+    mpd_uint_t *a = args->a;
+    mpd_size_t C = args->cols;
+    mpd_uint_t kernel = args->kernel;
     mpd_uint_t umod;
 #ifdef PPRO
     double dmod;
     uint32_t dinvmod[3];
 #endif
-    mpd_uint_t *x, w0, w1, wstep;
+    mpd_uint_t w0, w1, wstep;
     mpd_size_t i, k;
 
+    SETMODULUS(args->modnum);
+    for (i = (lo == 0) ? 1 : lo; i < hi; i++) {
+        w0 = 1;                  /* r**(i*0): initial value for k=0 */
+        w1 = POWMOD(kernel, i);  /* r**(i*1): initial value for k=1 */
+        wstep = MULMOD(w1, w1);  /* r**(2*i) */
+        for (k = 0; k < C; k += 2) {
+            mpd_uint_t x0 = a[i*C+k];
+            mpd_uint_t x1 = a[i*C+k+1];
+            MULMOD2(&x0, w0, &x1, w1);
+            MULMOD2C(&w0, &w1, wstep);  /* r**(i*(k+2)) = r**(i*k) * r**(2*i) */
+            a[i*C+k] = x0;
+            a[i*C+k+1] = x1;
+        }
+    }
+}
+
+static inline void
+fnt_rows(mpd_uint_t *a, mpd_size_t rows, mpd_size_t cols,
+         struct fnt_params *tparams)
+{
+    struct rows_args args = {a, cols, tparams, 0, tparams->modnum};
+    _mpd_parallel_for(rows, cols, _fnt_rows, &args);
+}
+
+static inline void
+twiddle_rows(mpd_uint_t *a, mpd_size_t rows, mpd_size_t cols,
+             mpd_uint_t kernel, int modnum)
+{
+    struct rows_args args = {a, cols, NULL, kernel, modnum};
+    _mpd_parallel_for(rows, cols, _twiddle_rows, &args);
+}
+
+
+/* forward transform with sign = -1 */
+int
+six_step_fnt(mpd_uint_t *a, mpd_size_t n, int modnum)
+{
+    struct fnt_params *tparams;
+    mpd_size_t log2n, C, R;
+    mpd_uint_t kernel;
+
 
     assert(ispower2(n));
     assert(n >= 16);
@@ -68,59 +134,35 @@ six_step_fnt(mpd_uint_t *a, mpd_size_t n, int modnum)
 
 
     /* Transpose the matrix. */
-    if (!transpose_pow2(a, R, C)) {
-        return 0;
-    }
+    transpose_pow2(a, R, C);
 
     /* Length R transform on the rows. */
-    if ((tparams = _mpd_init_fnt_params(R, -1, modnum)) == NULL) {
+    if ((tparams = _mpd_get_fnt_params(R, -1, modnum)) == NULL) {
         return 0;
     }
-    for (x = a; x < a+n; x += R) {
-        fnt_dif2(x, R, tparams);
-    }
+    fnt_rows(a, C, R, tparams);
 
     /* Transpose the matrix. */
-    if (!transpose_pow2(a, C, R)) {
-        mpd_free(tparams);
-        return 0;
-    }
+    transpose_pow2(a, C, R);
 
     /* Multiply each matrix element (addressed by i*C+k) by r**(i*k). */
-    SETMODULUS(modnum);
     kernel = _mpd_getkernel(n, -1, modnum);
-    for (i = 1; i < R; i++) {
-        w0 = 1;                  /* r**(i*0): initial value for k=0 */
-        w1 = POWMOD(kernel, i);  /* r**(i*1): initial value for k=1 */
-        wstep = MULMOD(w1, w1);  /* r**(2*i) */
-        for (k = 0; k < C; k += 2) {
-            mpd_uint_t x0 = a[i*C+k];
-            mpd_uint_t x1 = a[i*C+k+1];
-            MULMOD2(&x0, w0, &x1, w1);
-            MULMOD2C(&w0, &w1, wstep);  /* r**(i*(k+2)) = r**(i*k) * r**(2*i) */
-            a[i*C+k] = x0;
-            a[i*C+k+1] = x1;
-        }
-    }
+    twiddle_rows(a, R, C, kernel, modnum);
 
     /* Length C transform on the rows. */
     if (C != R) {
-        mpd_free(tparams);
-        if ((tparams = _mpd_init_fnt_params(C, -1, modnum)) == NULL) {
+        _mpd_release_fnt_params(tparams);
+        if ((tparams = _mpd_get_fnt_params(C, -1, modnum)) == NULL) {
             return 0;
         }
     }
-    for (x = a; x < a+n; x += C) {
-        fnt_dif2(x, C, tparams);
-    }
-    mpd_free(tparams);
+    fnt_rows(a, R, C, tparams);
+    _mpd_release_fnt_params(tparams);
 
 #if 0
     /* An unordered transform is sufficient for convolution. */
     /* Transpose the matrix. */
-    if (!transpose_pow2(a, R, C)) {
-        return 0;
-    }
+    transpose_pow2(a, R, C);
 #endif
 
     return 1;
@@ -134,13 +176,6 @@ inv_six_step_fnt(mpd_uint_t *a, mpd_size_t n, int modnum)
     struct fnt_params *tparams;
     mpd_size_t log2n, C, R;
     mpd_uint_t kernel;
-    mpd_uint_t umod;
-#ifdef PPRO
-    double dmod;
-    uint32_t dinvmod[3];
-#endif
-    mpd_uint_t *x, w0, w1, wstep;
-    mpd_size_t i, k;
 
 
     assert(ispower2(n));
@@ -155,58 +190,34 @@ inv_six_step_fnt(mpd_uint_t *a, mpd_size_t n, int modnum)
 #if 0
     /* An unordered transform is sufficient for convolution. */
     /* Transpose the matrix, producing an R*C matrix. */
-    if (!transpose_pow2(a, C, R)) {
-        return 0;
-    }
+    transpose_pow2(a, C, R);
 #endif
 
     /* Length C transform on the rows. */
-    if ((tparams = _mpd_init_fnt_params(C, 1, modnum)) == NULL) {
+    if ((tparams = _mpd_get_fnt_params(C, 1, modnum)) == NULL) {
         return 0;
     }
-    for (x = a; x < a+n; x += C) {
-        fnt_dif2(x, C, tparams);
-    }
+    fnt_rows(a, R, C, tparams);
 
     /* Multiply each matrix element (addressed by i*C+k) by r**(i*k). */
-    SETMODULUS(modnum);
     kernel = _mpd_getkernel(n, 1, modnum);
-    for (i = 1; i < R; i++) {
-        w0 = 1;
-        w1 = POWMOD(kernel, i);
-        wstep = MULMOD(w1, w1);
-        for (k = 0; k < C; k += 2) {
-            mpd_uint_t x0 = a[i*C+k];
-            mpd_uint_t x1 = a[i*C+k+1];
-            MULMOD2(&x0, w0, &x1, w1);
-            MULMOD2C(&w0, &w1, wstep);
-            a[i*C+k] = x0;
-            a[i*C+k+1] = x1;
-        }
-    }
+    twiddle_rows(a, R, C, kernel, modnum);
 
     /* Transpose the matrix. */
-    if (!transpose_pow2(a, R, C)) {
-        mpd_free(tparams);
-        return 0;
-    }
+    transpose_pow2(a, R, C);
 
     /* Length R transform on the rows. */
     if (R != C) {
-        mpd_free(tparams);
-        if ((tparams = _mpd_init_fnt_params(R, 1, modnum)) == NULL) {
+        _mpd_release_fnt_params(tparams);
+        if ((tparams = _mpd_get_fnt_params(R, 1, modnum)) == NULL) {
             return 0;
         }
     }
-    for (x = a; x < a+n; x += R) {
-        fnt_dif2(x, R, tparams);
-    }
-    mpd_free(tparams);
+    fnt_rows(a, C, R, tparams);
+    _mpd_release_fnt_params(tparams);
 
     /* Transpose the matrix. */
-    if (!transpose_pow2(a, C, R)) {
-        return 0;
-    }
+    transpose_pow2(a, C, R);
 
     return 1;
 }
@@ -35,12 +35,17 @@
 #include "bits.h"
 #include "constants.h"
 #include "mpdecimal.h"
+#include "mpthread.h"
 #include "transpose.h"
 #include "typearith.h"
 
 
-#define BUFSIZE 4096
-#define SIDE 128
+/* Side length of the blocks that are transposed directly. */
+#define TRANS_BASE 8
+/* Side length of the tiles that are distributed over the thread pool. */
+#define TRANS_TILE 64
+/* Halfrows are permuted in chunks of this many words. */
+#define HALFROW_CHUNK 512
 
 
 /* Bignum: The transpose functions are used for very large transforms
@@ -65,184 +70,231 @@ std_trans(mpd_uint_t dest[], mpd_uint_t src[], mpd_size_t rows, mpd_size_t cols)
     }
 }
 
+/* Return 1 if hn is the smallest halfrow number in its cycle. */
+static inline int
+is_cycle_leader(mpd_size_t hn, mpd_size_t r, mpd_size_t m)
+{
+    mpd_size_t next;
+
+    for (next = mulmod_size_t(hn, r, m); next != hn;
+         next = mulmod_size_t(next, r, m)) {
+        if (next < hn) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+struct halfrow_args {
+    mpd_uint_t *matrix;
+    mpd_size_t hlen;    /* length of a halfrow */
+    mpd_size_t r;       /* the halfrow at position p moves to p*r mod m */
+    mpd_size_t rinv;    /* r**-1 mod m */
+    mpd_size_t m;
+};
+
+/*
+ * Rotate the cycles led by the halfrows [lo+1, hi+1). The cycles are
+ * walked backwards, so that every word is copied once, and the leader
+ * is saved in a small chunk buffer.
+ */
+static void
+_swap_halfrow_cycles(void *arg, mpd_size_t lo, mpd_size_t hi)
+{
+    struct halfrow_args *args = arg;
+    mpd_uint_t buf[HALFROW_CHUNK];
+    mpd_uint_t *matrix = args->matrix;
+    mpd_size_t hlen = args->hlen;
+    mpd_size_t m = args->m;
+    mpd_size_t hn, cur, prev, offset, len;
+
+    for (hn = lo+1; hn < hi+1; hn++) {
+
+        if (!is_cycle_leader(hn, args->r, m)) {
+            continue;
+        }
+
+        for (offset = 0; offset < hlen; offset += HALFROW_CHUNK) {
+
+            len = (offset + HALFROW_CHUNK < hlen) ? HALFROW_CHUNK : hlen-offset;
+
+            memcpy(buf, matrix+hn*hlen+offset, len * (sizeof *buf));
+            cur = hn;
+            prev = mulmod_size_t(hn, args->rinv, m);
+            while (prev != hn) {
+                memcpy(matrix+cur*hlen+offset, matrix+prev*hlen+offset,
+                       len * (sizeof *buf));
+                cur = prev;
+                prev = mulmod_size_t(prev, args->rinv, m);
+            }
+            memcpy(matrix+cur*hlen+offset, buf, len * (sizeof *buf));
+        }
+    }
+}
+
 /*
  * Swap half-rows of 2^n * (2*2^n) matrix.
  * FORWARD_CYCLE: even/odd permutation of the halfrows.
  * BACKWARD_CYCLE: reverse the even/odd permutation.
+ *
+ * Each cycle of the permutation is processed by its smallest member, so
+ * no bookkeeping is required. The cycles are short (at most log2(cols)
+ * halfrows), so the leader test is cheap.
  */
-static int
+static void
 swap_halfrows_pow2(mpd_uint_t *matrix, mpd_size_t rows, mpd_size_t cols, int dir)
 {
-    mpd_uint_t buf1[BUFSIZE];
-    mpd_uint_t buf2[BUFSIZE];
-    mpd_uint_t *readbuf, *writebuf, *hp;
-    mpd_size_t *done, dbits;
-    mpd_size_t b = BUFSIZE, stride;
-    mpd_size_t hn, hmax; /* halfrow number */
-    mpd_size_t m, r=0;
-    mpd_size_t offset;
-    mpd_size_t next;
-
+    struct halfrow_args args;
 
     assert(cols == mul_size_t(2, rows));
 
+    /* rows * 2 == 1 (mod cols-1) */
     if (dir == FORWARD_CYCLE) {
-        r = rows;
+        args.r = rows;
+        args.rinv = 2;
     }
     else if (dir == BACKWARD_CYCLE) {
-        r = 2;
+        args.r = 2;
+        args.rinv = rows;
     }
     else {
         abort(); /* GCOV_NOT_REACHED */
     }
 
-    m = cols - 1;
-    hmax = rows; /* cycles start at odd halfrows */
-    dbits = 8 * sizeof *done;
-    if ((done = mpd_calloc(hmax/(sizeof *done) + 1, sizeof *done)) == NULL) {
-        return 0;
-    }
-
-    for (hn = 1; hn <= hmax; hn += 2) {
-
-        if (done[hn/dbits] & mpd_bits[hn%dbits]) {
-            continue;
-        }
+    args.matrix = matrix;
+    args.hlen = cols/2;
+    args.m = cols - 1;
 
-        readbuf = buf1; writebuf = buf2;
-
-        for (offset = 0; offset < cols/2; offset += b) {
-
-            stride = (offset + b < cols/2) ? b : cols/2-offset;
-
-            hp = matrix + hn*cols/2;
-            memcpy(readbuf, hp+offset, stride*(sizeof *readbuf));
-            pointerswap(&readbuf, &writebuf);
-
-            next = mulmod_size_t(hn, r, m);
-            hp = matrix + next*cols/2;
+    /* halfrows 0 and m are fixed points */
+    _mpd_parallel_for(args.m-1, args.hlen, _swap_halfrow_cycles, &args);
+}
 
-            while (next != hn) {
+/* In-place transpose of a square block with side length n */
+static inline void
+squaretrans(mpd_uint_t *a, mpd_size_t n, mpd_size_t stride)
+{
+    mpd_uint_t tmp;
+    mpd_size_t idest, isrc;
+    mpd_size_t r, c;
 
-                memcpy(readbuf, hp+offset, stride*(sizeof *readbuf));
-                memcpy(hp+offset, writebuf, stride*(sizeof *writebuf));
-                pointerswap(&readbuf, &writebuf);
+    for (r = 0; r < n; r++) {
+        c = r+1;
+        isrc = r*stride + c;
+        idest = c*stride + r;
+        for (c = r+1; c < n; c++) {
+            tmp = a[isrc];
+            a[isrc] = a[idest];
+            a[idest] = tmp;
+            isrc += 1;
+            idest += stride;
+        }
+    }
+}
 
-                done[next/dbits] |= mpd_bits[next%dbits];
+/* Exchange the rows x cols block a with the transpose of the cols x rows
+   block b. */
+static void
+swaptrans(mpd_uint_t *a, mpd_uint_t *b, mpd_size_t rows, mpd_size_t cols,
+          mpd_size_t stride)
+{
+    mpd_uint_t tmp;
+    mpd_size_t r, c;
 
-                next = mulmod_size_t(next, r, m);
-                hp = matrix + next*cols/2;
+    if (rows > TRANS_BASE || cols > TRANS_BASE) {
+        if (rows >= cols) {
+            swaptrans(a, b, rows/2, cols, stride);
+            swaptrans(a+(rows/2)*stride, b+rows/2, rows-rows/2, cols, stride);
+        }
+        else {
+            swaptrans(a, b, rows, cols/2, stride);
+            swaptrans(a+cols/2, b+(cols/2)*stride, rows, cols-cols/2, stride);
+        }
+        return;
+    }
 
-            }
+    for (r = 0; r < rows; r++) {
+        for (c = 0; c < cols; c++) {
+            tmp = a[r*stride+c];
+            a[r*stride+c] = b[c*stride+r];
+            b[c*stride+r] = tmp;
+        }
+    }
+}
 
-            memcpy(hp+offset, writebuf, stride*(sizeof *writebuf));
+/* Cache-oblivious in-place transpose of a square block with side length n:
+   transpose the two diagonal quadrants and exchange the other two. */
+static void
+squaretrans_rec(mpd_uint_t *a, mpd_size_t n, mpd_size_t stride)
+{
+    mpd_size_t h;
 
-            done[hn/dbits] |= mpd_bits[hn%dbits];
-        }
+    if (n <= TRANS_BASE) {
+        squaretrans(a, n, stride);
+        return;
     }
 
-    mpd_free(done);
-    return 1;
+    h = n / 2;
+    squaretrans_rec(a, h, stride);
+    squaretrans_rec(a+h*stride+h, n-h, stride);
+    swaptrans(a+h, a+h*stride, h, n-h, stride);
 }
 
-/* In-place transpose of a square matrix */
-static inline void
-squaretrans(mpd_uint_t *buf, mpd_size_t cols)
-{
-    mpd_uint_t tmp;
-    mpd_size_t idest, isrc;
-    mpd_size_t r, c;
+struct tiles_args {
+    mpd_uint_t *matrix;
+    mpd_size_t size;
+    mpd_size_t ntiles;  /* tiles per row */
+    mpd_size_t b;       /* side length of a tile */
+};
 
-    for (r = 0; r < cols; r++) {
-        c = r+1;
-        isrc = r*cols + c;
-        idest = c*cols + r;
-        for (c = r+1; c < cols; c++) {
-            tmp = buf[isrc];
-            buf[isrc] = buf[idest];
-            buf[idest] = tmp;
-            isrc += 1;
-            idest += cols;
+/* Tiles (r, c) and (c, r) are handled by the item r*ntiles + c with r <= c. */
+static void
+_squaretrans_tiles(void *arg, mpd_size_t lo, mpd_size_t hi)
+{
+    struct tiles_args *args = arg;
+    mpd_size_t size = args->size;
+    mpd_size_t b = args->b;
+    mpd_size_t k, r, c;
+
+    for (k = lo; k < hi; k++) {
+        r = k / args->ntiles;
+        c = k % args->ntiles;
+        if (r == c) {
+            squaretrans_rec(args->matrix + r*b*size + c*b, b, size);
+        }
+        else if (r < c) {
+            swaptrans(args->matrix + r*b*size + c*b,
+                      args->matrix + c*b*size + r*b, b, b, size);
         }
     }
 }
 
 /*
- * Transpose 2^n * 2^n matrix. For cache efficiency, the matrix is split into
- * square blocks with side length 'SIDE'. First, the blocks are transposed,
- * then a square transposition is done on each individual block.
+ * Transpose 2^n * 2^n matrix. The matrix is split into tiles with side
+ * length 'TRANS_TILE' that can be processed concurrently. Within a tile,
+ * the transposition is recursive and needs no buffers.
  */
 static void
 squaretrans_pow2(mpd_uint_t *matrix, mpd_size_t size)
 {
-    mpd_uint_t buf1[SIDE*SIDE];
-    mpd_uint_t buf2[SIDE*SIDE];
-    mpd_uint_t *to, *from;
+    struct tiles_args args;
     mpd_size_t b = size;
-    mpd_size_t r, c;
-    mpd_size_t i;
 
-    while (b > SIDE) b >>= 1;
+    while (b > TRANS_TILE) b >>= 1;
 
-    for (r = 0; r < size; r += b) {
-
-        for (c = r; c < size; c += b) {
-
-            from = matrix + r*size + c;
-            to = buf1;
-            for (i = 0; i < b; i++) {
-                memcpy(to, from, b*(sizeof *to));
-                from += size;
-                to += b;
-            }
-            squaretrans(buf1, b);
-
-            if (r == c) {
-                to = matrix + r*size + c;
-                from = buf1;
-                for (i = 0; i < b; i++) {
-                    memcpy(to, from, b*(sizeof *to));
-                    from += b;
-                    to += size;
-                }
-                continue;
-            }
-            else {
-                from = matrix + c*size + r;
-                to = buf2;
-                for (i = 0; i < b; i++) {
-                    memcpy(to, from, b*(sizeof *to));
-                    from += size;
-                    to += b;
-                }
-                squaretrans(buf2, b);
-
-                to = matrix + c*size + r;
-                from = buf1;
-                for (i = 0; i < b; i++) {
-                    memcpy(to, from, b*(sizeof *to));
-                    from += b;
-                    to += size;
-                }
-
-                to = matrix + r*size + c;
-                from = buf2;
-                for (i = 0; i < b; i++) {
-                    memcpy(to, from, b*(sizeof *to));
-                    from += b;
-                    to += size;
-                }
-            }
-        }
-    }
+    args.matrix = matrix;
+    args.size = size;
+    args.ntiles = size / b;
+    args.b = b;
 
+    _mpd_parallel_for(args.ntiles*args.ntiles, b*b, _squaretrans_tiles, &args);
 }
 
 /*
  * In-place transposition of a 2^n x 2^n or a 2^n x (2*2^n)
  * or a (2*2^n) x 2^n matrix.
  */
-int
+void
 transpose_pow2(mpd_uint_t *matrix, mpd_size_t rows, mpd_size_t cols)
 {
     mpd_size_t size = mul_size_t(rows, cols);
@@ -254,22 +306,16 @@ transpose_pow2(mpd_uint_t *matrix, mpd_size_t rows, mpd_size_t cols)
         squaretrans_pow2(matrix, rows);
     }
     else if (cols == mul_size_t(2, rows)) {
-        if (!swap_halfrows_pow2(matrix, rows, cols, FORWARD_CYCLE)) {
-            return 0;
-        }
+        swap_halfrows_pow2(matrix, rows, cols, FORWARD_CYCLE);
         squaretrans_pow2(matrix, rows);
         squaretrans_pow2(matrix+(size/2), rows);
     }
     else if (rows == mul_size_t(2, cols)) {
         squaretrans_pow2(matrix, cols);
         squaretrans_pow2(matrix+(size/2), cols);
-        if (!swap_halfrows_pow2(matrix, cols, rows, BACKWARD_CYCLE)) {
-            return 0;
-        }
+        swap_halfrows_pow2(matrix, cols, rows, BACKWARD_CYCLE);
     }
     else {
         abort(); /* GCOV_NOT_REACHED */
     }
-
-    return 1;
 }